@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Micro-benchmarks of hot paths: Markdown rendering, batch rendering of list pages, expression parsing, attachment
+ * cache, avatar generation and post URLs.
+ *
+ * Usage: cxxblog_bench [Google Benchmark options], e.g. --benchmark_format=json --benchmark_out=current.json
+ *
+ * Compare results with the baseline using bench/compare.py.
+ */
+
+#include "AttachmentCache.h"
+#include "AvatarGenerator.h"
+#include "ExpressionParser.h"
+#include "Markdown.h"
+#include "OutputSink.h"
+#include "RenderPool.h"
+
+#include "models/Post.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::vector<std::string> g_Words = {
+        "template", "compiler", "allocator", "database", "transaction", "session", "widget", "resource",
+        "markdown", "expression", "parser", "iterator", "container", "algorithm", "pointer", "reference"
+    };
+
+    std::string generateMarkdown(std::size_t paragraphs)
+    {
+        std::mt19937 rng { 42u };
+        std::uniform_int_distribution<std::size_t> word { 0u, g_Words.size() - 1u };
+        std::string markdown;
+
+        for (std::size_t i = 0u; i < paragraphs; ++i)
+        {
+            switch (i % 5u)
+            {
+            case 0u:
+                markdown += "## " + g_Words[word(rng)] + " " + g_Words[word(rng)] + "\n\n";
+                break;
+            case 1u:
+                markdown += "```cpp\nauto " + g_Words[word(rng)] + " = std::make_unique<" + g_Words[word(rng)] + ">();\n```\n\n";
+                break;
+            case 2u:
+                markdown += "| a | b |\n|---|---|\n| " + g_Words[word(rng)] + " | " + g_Words[word(rng)] + " |\n\n";
+                break;
+            default:
+                break;
+            }
+
+            for (std::size_t j = 0u; j < 60u; ++j)
+            {
+                const auto& w = g_Words[word(rng)];
+                markdown += (j % 15u == 7u) ? "**" + w + "** " : (j % 20u == 3u) ? "[" + w + "](https://example.com/" + w + ") " : w + " ";
+            }
+
+            markdown += "\n\n";
+        }
+
+        return markdown;
+    }
+
+    std::string generateExpressions(std::size_t count)
+    {
+        std::string content;
+
+        for (std::size_t i = 0u; i < count; ++i)
+            content += "Paragraph " + std::to_string(i) + " $(echo some, $(echo nested, text)) and $(image 12, a caption).\n";
+
+        return content;
+    }
+
+    // Renders images the way snapshots do, without templates which need a running server.
+    class BenchmarkContext
+        : public ExpressionParser::Context
+    {
+    public:
+        std::string image(const std::string& id, const std::string& caption) const override
+        {
+            return "<img src=\"/attachment/" + id + "\" alt=\"" + caption + "\"/>";
+        }
+    };
+
+    void BM_MarkdownRender(benchmark::State& state)
+    {
+        static const auto init = (Markdown::init(), true);
+        (void)init;
+
+        const auto markdown = generateMarkdown(static_cast<std::size_t>(state.range(0)));
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(Markdown(markdown).renderHTML());
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * markdown.size()));
+    }
+    BENCHMARK(BM_MarkdownRender)->Arg(5)->Arg(200)->Arg(5000);
+
+    // Parse and teardown only, the part served by the AST arena.
+    void BM_MarkdownParse(benchmark::State& state)
+    {
+        static const auto init = (Markdown::init(), true);
+        (void)init;
+
+        const auto markdown = generateMarkdown(static_cast<std::size_t>(state.range(0)));
+
+        for (auto _ : state)
+        {
+            Markdown document { markdown };
+            benchmark::DoNotOptimize(&document);
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * markdown.size()));
+    }
+    BENCHMARK(BM_MarkdownParse)->Arg(200)->Arg(5000);
+
+    // List page of intros, second argument selects rendering through RenderPool instead of one by one.
+    void BM_IntroBatchRender(benchmark::State& state)
+    {
+        static const auto init = (Markdown::init(), true);
+        (void)init;
+
+        const std::vector<std::string> intros(static_cast<std::size_t>(state.range(0)), generateMarkdown(3u));
+        const auto pooled = state.range(1) != 0;
+
+        for (auto _ : state)
+        {
+            if (pooled)
+            {
+                benchmark::DoNotOptimize(RenderPool::instance().renderHTML(intros));
+            }
+            else
+            {
+                std::vector<std::string> html;
+                for (const auto& intro : intros)
+                    html.emplace_back(Markdown(intro).renderHTML());
+
+                benchmark::DoNotOptimize(html);
+            }
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * intros.size()));
+    }
+    BENCHMARK(BM_IntroBatchRender)->Args({ 10, 0 })->Args({ 10, 1 })->Args({ 100, 0 })->Args({ 100, 1 })->UseRealTime();
+
+    // Post content path of snapshots: markdown rendered and expressions resolved into one output buffer.
+    void BM_PostContentRender(benchmark::State& state)
+    {
+        static const auto init = (Markdown::init(), true);
+        (void)init;
+
+        const auto markdown = generateMarkdown(static_cast<std::size_t>(state.range(0))) + generateExpressions(static_cast<std::size_t>(state.range(0)));
+        std::string output;
+
+        for (auto _ : state)
+        {
+            const auto html = Markdown(markdown).render();
+
+            ExpressionParser parser;
+            parser.parse(html.view());
+
+            output.clear();
+            OutputSink out { output };
+            parser.resolve(BenchmarkContext {}, out);
+
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * markdown.size()));
+    }
+    BENCHMARK(BM_PostContentRender)->Arg(5)->Arg(200);
+
+    void BM_ExpressionParser(benchmark::State& state)
+    {
+        const auto content = generateExpressions(static_cast<std::size_t>(state.range(0)));
+
+        for (auto _ : state)
+        {
+            ExpressionParser parser;
+            parser.parse(content);
+            benchmark::DoNotOptimize(parser.resolve(BenchmarkContext {}));
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_ExpressionParser)->Arg(10)->Arg(100)->Arg(1000);
+
+    std::string fillTo(std::size_t size, const std::string& pattern)
+    {
+        std::string content;
+        content.reserve(size + pattern.size());
+
+        while (content.size() < size)
+            content += pattern;
+
+        return content;
+    }
+
+    std::string nestedTo(std::size_t size)
+    {
+        // Expression nested far past the depth limit, so every level fails to parse.
+        auto content = "$(echo " + fillTo(size, "$(x, ");
+        content.append(std::count(content.begin(), content.end(), '$'), ')');
+
+        return content;
+    }
+
+    // Megabyte-sized inputs: regular text with expressions, mostly stray tags with a single expression at the end, and
+    // a single deeply nested expression.
+    void BM_ExpressionScan(benchmark::State& state)
+    {
+        const auto size = static_cast<std::size_t>(state.range(0));
+        const auto content = state.range(1) == 0
+            ? fillTo(size, "Paragraph with $(echo some, text) and a stray ) or $ character.\n")
+            : state.range(1) == 1
+                ? fillTo(size, "$ ) \\$( text $") + "$(echo last)"
+                : nestedTo(size);
+
+        for (auto _ : state)
+        {
+            ExpressionParser parser;
+            parser.parse(content);
+            benchmark::DoNotOptimize(parser.resolve(BenchmarkContext {}));
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * content.size()));
+    }
+    BENCHMARK(BM_ExpressionScan)->Args({ 1 << 20, 0 })->Args({ 4 << 20, 0 })->Args({ 1 << 20, 1 })->Args({ 4 << 20, 1 })->Args({ 1 << 20, 2 })->Args({ 4 << 20, 2 })->Unit(benchmark::kMillisecond);
+
+    void BM_AttachmentCache(benchmark::State& state)
+    {
+        auto& cache = AttachmentCache::instance();
+        const std::vector<uint8_t> data(static_cast<std::size_t>(state.range(0)), 0x2a);
+
+        if (state.thread_index() == 0)
+        {
+            // Cache lives relative to the working directory when there is no server.
+            std::filesystem::create_directories(cache.cachePath());
+
+            for (auto i = 0; i < 16; ++i)
+                cache.set("bench-" + std::to_string(i), data, "image/png");
+        }
+
+        auto i = state.thread_index();
+
+        for (auto _ : state)
+        {
+            // Mostly reads with an occasional write, like attachments served while an editor uploads one.
+            const auto id = "bench-" + std::to_string(i++ % 16);
+
+            if (i % 64 == 0)
+                cache.set(id, data, "image/png");
+            else
+                benchmark::DoNotOptimize(cache.get(id));
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    }
+    BENCHMARK(BM_AttachmentCache)->Arg(16 * 1024)->Threads(1)->Threads(8)->UseRealTime();
+
+    void BM_AvatarGenerator(benchmark::State& state)
+    {
+        AvatarGenerator generator { static_cast<double>(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(generator.generate("Benchmark Editor"));
+    }
+    BENCHMARK(BM_AvatarGenerator)->Arg(128)->Arg(512);
+
+    void BM_PostUrl(benchmark::State& state)
+    {
+        const Wt::WString title = Wt::WString::fromUTF8("Zero-cost abstractions: measuring std::variant, std::visit & friends in C++17");
+        long long id = 0;
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(Post::url(++id, title));
+    }
+    BENCHMARK(BM_PostUrl);
+}
+
+BENCHMARK_MAIN();
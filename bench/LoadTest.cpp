@@ -0,0 +1,599 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Drives the full HTTP stack (Wt HTTP server, resources, pools, SQLite) with concurrent keep-alive clients
+ * and reports throughput and latency percentiles per route.
+ *
+ * Usage: cxxblog_loadtest [--resources <dir>] [--approot <dir>] [--docroot <dir>] [--port <port>]
+ *                         [--editors <count>] [--posts <count>] [--attachments <count>]
+ *                         [--threads <count>] [--duration <seconds>]
+ *
+ * Run it from the build directory (or point --resources to it), wt_config.xml and xml/ are taken from there.
+ * Approot directory is recreated on each run and seeded with a fresh SQLite database.
+ */
+
+#include "BlogServer.h"
+#include "Markdown.h"
+
+#include "models/Attachment.h"
+#include "models/BasicSession.h"
+#include "models/ConnectionPool.h"
+#include "models/Editor.h"
+#include "models/Post.h"
+#include "models/SchemaManager.h"
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Dbo/backend/Sqlite3.h>
+#include <Wt/WServer.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Smallest valid PNG (1x1, transparent), served as attachment and referenced from posts.
+    const std::vector<uint8_t> g_PngImage = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0x15, 0xc4,
+        0x89, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x00, 0x01, 0x00, 0x00,
+        0x05, 0x00, 0x01, 0x0d, 0x0a, 0x2d, 0xb4, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+        0x42, 0x60, 0x82
+    };
+
+    const std::string g_PostContent = R"(Load test post, rendered by the same path as every other post.
+
+## Code
+
+```cpp
+template<typename T>
+T accumulate(const std::vector<T>& values)
+{
+    return std::accumulate(values.begin(), values.end(), T {});
+}
+```
+
+## Table
+
+| Route | Pool | Cached |
+|-------|------|--------|
+| post | consistent read | yes |
+| avatar | read | no |
+| attachment | read | yes |
+
+)";
+
+    struct Options
+    {
+        std::string resources = ".";
+        std::string approot = "loadtest";
+        std::string docroot = ".";
+        std::string port = "18080";
+        std::size_t editors = 10u;
+        std::size_t posts = 200u;
+        std::size_t attachments = 20u;
+        std::size_t threads = 8u;
+        std::chrono::seconds duration { 30 };
+    };
+
+    struct Targets
+    {
+        std::vector<std::string> editorHandles;
+        std::vector<long long> postIds;
+        std::vector<long long> attachmentIds;
+    };
+
+    struct Route
+    {
+        std::string name;
+        unsigned weight;
+        std::function<std::string(std::mt19937&)> path;
+    };
+
+    struct RouteStats
+    {
+        std::vector<Clock::duration> latencies;
+        uint64_t errors = 0u;
+    };
+
+    /**
+     * Minimal HTTP/1.1 client over a keep-alive connection, reconnects when the server closes it.
+     */
+    class HttpClient
+    {
+    public:
+        explicit HttpClient(uint16_t port)
+            : _port(port)
+        { }
+
+        ~HttpClient()
+        {
+            disconnect();
+        }
+
+        /**
+         * Sends GET request and reads the whole response. Returns status code, or 0 on connection failure.
+         */
+        int get(const std::string& path)
+        {
+            // Server may have closed idle connection, retry once on a fresh one.
+            for (auto attempt = 0; attempt < 2; ++attempt)
+            {
+                if (_socket < 0 && !connect())
+                    return 0;
+
+                try
+                {
+                    auto status = exchange(path);
+                    if (status > 0)
+                        return status;
+                }
+                catch (const std::exception&)
+                {
+                    // Malformed response, connection state is unknown.
+                }
+
+                disconnect();
+            }
+
+            return 0;
+        }
+
+    private:
+        bool connect()
+        {
+            _socket = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (_socket < 0)
+                return false;
+
+            int noDelay = 1;
+            ::setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+            sockaddr_in address {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(_port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            if (::connect(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                disconnect();
+                return false;
+            }
+
+            _buffer.clear();
+            return true;
+        }
+
+        void disconnect()
+        {
+            if (_socket >= 0)
+                ::close(_socket);
+
+            _socket = -1;
+        }
+
+        bool fill()
+        {
+            char chunk[16384];
+            auto received = ::recv(_socket, chunk, sizeof(chunk), 0);
+
+            if (received <= 0)
+                return false;
+
+            _buffer.append(chunk, static_cast<std::size_t>(received));
+            return true;
+        }
+
+        bool readLine(std::string& line)
+        {
+            std::string::size_type end;
+
+            while ((end = _buffer.find("\r\n")) == std::string::npos)
+            {
+                if (!fill())
+                    return false;
+            }
+
+            line = _buffer.substr(0u, end);
+            _buffer.erase(0u, end + 2u);
+            return true;
+        }
+
+        bool skip(std::size_t size)
+        {
+            while (_buffer.size() < size)
+            {
+                if (!fill())
+                    return false;
+            }
+
+            _buffer.erase(0u, size);
+            return true;
+        }
+
+        int exchange(const std::string& path)
+        {
+            const auto request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+
+            if (::send(_socket, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()))
+                return 0;
+
+            std::string line;
+            if (!readLine(line) || line.compare(0u, 5u, "HTTP/") != 0 || line.size() < 12u)
+                return 0;
+
+            const auto status = std::atoi(line.c_str() + 9);
+
+            std::size_t contentLength = 0u;
+            bool hasContentLength = false;
+            bool chunked = false;
+            bool close = false;
+
+            while (readLine(line) && !line.empty())
+            {
+                auto colon = line.find(':');
+                if (colon == std::string::npos)
+                    continue;
+
+                auto name = line.substr(0u, colon);
+                auto valueStart = line.find_first_not_of(' ', colon + 1u);
+                auto value = valueStart != std::string::npos ? line.substr(valueStart) : std::string();
+
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+                if (name == "content-length")
+                {
+                    contentLength = std::stoul(value);
+                    hasContentLength = true;
+                }
+                else if (name == "transfer-encoding")
+                {
+                    chunked = value.find("chunked") != std::string::npos;
+                }
+                else if (name == "connection")
+                {
+                    close = value == "close";
+                }
+            }
+
+            if (chunked)
+            {
+                while (true)
+                {
+                    if (!readLine(line))
+                        return 0;
+
+                    auto size = std::stoul(line, nullptr, 16);
+
+                    // Chunk data is followed by CRLF, last chunk has no data but also no trailers here.
+                    if (!skip(size + 2u))
+                        return 0;
+
+                    if (size == 0u)
+                        break;
+                }
+            }
+            else if (hasContentLength)
+            {
+                if (!skip(contentLength))
+                    return 0;
+            }
+            else
+            {
+                // Body delimited by connection close.
+                while (fill())
+                    ;
+
+                close = true;
+            }
+
+            if (close)
+                disconnect();
+
+            return status;
+        }
+
+        const uint16_t _port;
+        int _socket = -1;
+        std::string _buffer;
+    };
+
+    Options parseOptions(int argc, char** argv)
+    {
+        Options options;
+
+        for (auto i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string name = argv[i];
+            const std::string value = argv[i + 1];
+
+            if (name == "--resources")
+                options.resources = value;
+            else if (name == "--approot")
+                options.approot = value;
+            else if (name == "--docroot")
+                options.docroot = value;
+            else if (name == "--port")
+                options.port = value;
+            else if (name == "--editors")
+                options.editors = std::max<std::size_t>(1u, std::stoul(value));
+            else if (name == "--posts")
+                options.posts = std::max<std::size_t>(1u, std::stoul(value));
+            else if (name == "--attachments")
+                options.attachments = std::max<std::size_t>(1u, std::stoul(value));
+            else if (name == "--threads")
+                options.threads = std::max<std::size_t>(1u, std::stoul(value));
+            else if (name == "--duration")
+                options.duration = std::chrono::seconds(std::stoul(value));
+            else
+                throw std::invalid_argument("Unknown option " + name);
+        }
+
+        return options;
+    }
+
+    void prepareAppRoot(const Options& options)
+    {
+        fs::remove_all(options.approot);
+        fs::create_directories(options.approot);
+        fs::copy(fs::path(options.resources) / "xml", fs::path(options.approot) / "xml", fs::copy_options::recursive);
+    }
+
+    Targets seed(const Options& options)
+    {
+        auto backend { std::make_unique<dbo::backend::Sqlite3>((fs::path(options.approot) / "database.sq3").string()) };
+        backend->setDateTimeStorage(dbo::SqlDateTimeType::DateTime, dbo::backend::DateTimeStorage::PseudoISO8601AsText);
+
+        ConnectionPool::Options poolOptions;
+        poolOptions.size = 1u;
+        poolOptions.setupStatements = ConnectionPool::sqliteProfile();
+
+        ConnectionPool pool { std::move(backend), poolOptions };
+        SchemaManager("/", pool).update();
+
+        BasicSession session { pool };
+        dbo::Transaction t { session };
+
+        Targets targets;
+        std::vector<dbo::ptr<Editor>> editors;
+
+        for (std::size_t i = 0u; i < options.editors; ++i)
+        {
+            auto editor = session.addNew<Editor>();
+            editor.modify()->name = "Editor " + std::to_string(i);
+            editor.modify()->handle = "editor-" + std::to_string(i);
+            editor.modify()->role = Editor::Role::Writer;
+
+            targets.editorHandles.emplace_back(editor->handle.toUTF8());
+            editors.emplace_back(std::move(editor));
+        }
+
+        for (std::size_t i = 0u; i < options.attachments; ++i)
+        {
+            auto attachment = session.addNew<Attachment>();
+            attachment.modify()->created = Wt::WDateTime::currentDateTime();
+            attachment.modify()->name = "image-" + std::to_string(i) + ".png";
+            attachment.modify()->mimeType = "image/png";
+            attachment.modify()->data = g_PngImage;
+            attachment.flush();
+
+            targets.attachmentIds.emplace_back(attachment.id());
+        }
+
+        for (std::size_t i = 0u; i < options.posts; ++i)
+        {
+            const auto imageId = targets.attachmentIds[i % targets.attachmentIds.size()];
+
+            auto post = session.addNew<Post>();
+            post.modify()->author = editors[i % editors.size()];
+            post.modify()->created = post.modify()->published = Wt::WDateTime::currentDateTime();
+            post.modify()->visibility = Post::Visibility::Published;
+            post.modify()->title = "Load test post " + std::to_string(i);
+            post.modify()->intro = "Intro of load test post " + std::to_string(i);
+            post.modify()->content = g_PostContent + "$(image " + std::to_string(imageId) + ", Figure " + std::to_string(i) + ")\n";
+            post.flush();
+
+            targets.postIds.emplace_back(post.id());
+        }
+
+        t.commit();
+        return targets;
+    }
+
+    std::vector<Route> routes(const Targets& targets)
+    {
+        auto pick = [](const auto& values, std::mt19937& rng) -> const auto&
+        {
+            return values[std::uniform_int_distribution<std::size_t> { 0u, values.size() - 1u }(rng)];
+        };
+
+        // Weights roughly follow anonymous traffic: mostly post pages and the images they embed.
+        return {
+            { "post", 40u, [&targets, pick](std::mt19937& rng) { return "/post/" + std::to_string(pick(targets.postIds, rng)); } },
+            { "posts", 10u, [](std::mt19937&) { return std::string("/posts"); } },
+            { "attachment", 25u, [&targets, pick](std::mt19937& rng) { return "/attachment/" + std::to_string(pick(targets.attachmentIds, rng)); } },
+            { "avatar", 15u, [&targets, pick](std::mt19937& rng) { return "/avatar/" + pick(targets.editorHandles, rng); } },
+            { "feed", 5u, [](std::mt19937&) { return std::string("/feed/atom"); } },
+            { "application", 5u, [](std::mt19937&) { return std::string("/"); } }
+        };
+    }
+
+    std::vector<RouteStats> drive(const std::vector<Route>& routes, const Options& options)
+    {
+        std::vector<unsigned> weights;
+        for (const auto& route : routes)
+            weights.emplace_back(route.weight);
+
+        std::vector<std::vector<RouteStats>> threadStats(options.threads, std::vector<RouteStats>(routes.size()));
+        std::vector<std::thread> threads;
+
+        const auto port = static_cast<uint16_t>(std::stoul(options.port));
+        const auto deadline = Clock::now() + options.duration;
+
+        for (std::size_t i = 0u; i < options.threads; ++i)
+        {
+            threads.emplace_back([&, i]
+            {
+                std::mt19937 rng { static_cast<std::mt19937::result_type>(i + 1u) };
+                std::discrete_distribution<std::size_t> routeDistribution { weights.begin(), weights.end() };
+                HttpClient client { port };
+                auto& stats = threadStats[i];
+
+                while (Clock::now() < deadline)
+                {
+                    const auto routeIndex = routeDistribution(rng);
+                    const auto path = routes[routeIndex].path(rng);
+
+                    const auto start = Clock::now();
+                    const auto status = client.get(path);
+                    const auto elapsed = Clock::now() - start;
+
+                    if (status == 200)
+                        stats[routeIndex].latencies.emplace_back(elapsed);
+                    else
+                        ++stats[routeIndex].errors;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::vector<RouteStats> merged(routes.size());
+
+        for (auto& stats : threadStats)
+        {
+            for (std::size_t r = 0u; r < routes.size(); ++r)
+            {
+                merged[r].latencies.insert(merged[r].latencies.end(), stats[r].latencies.begin(), stats[r].latencies.end());
+                merged[r].errors += stats[r].errors;
+            }
+        }
+
+        return merged;
+    }
+
+    double percentileMs(const std::vector<Clock::duration>& sorted, double percentile)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto index = std::min(sorted.size() - 1u, static_cast<std::size_t>(percentile * static_cast<double>(sorted.size())));
+        return std::chrono::duration<double, std::milli>(sorted[index]).count();
+    }
+
+    void report(const std::vector<Route>& routes, std::vector<RouteStats>& stats, std::chrono::seconds duration)
+    {
+        const auto seconds = std::max<double>(1.0, static_cast<double>(duration.count()));
+        uint64_t totalRequests = 0u;
+        uint64_t totalErrors = 0u;
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "route\trequests\terrors\treq/s\tp50 [ms]\tp99 [ms]\tp99.9 [ms]" << std::endl;
+
+        for (std::size_t r = 0u; r < routes.size(); ++r)
+        {
+            auto& latencies = stats[r].latencies;
+            std::sort(latencies.begin(), latencies.end());
+
+            std::cout << routes[r].name << '\t' << latencies.size() << '\t' << stats[r].errors << '\t'
+                << static_cast<double>(latencies.size()) / seconds << '\t' << percentileMs(latencies, 0.5) << '\t'
+                << percentileMs(latencies, 0.99) << '\t' << percentileMs(latencies, 0.999) << std::endl;
+
+            totalRequests += latencies.size();
+            totalErrors += stats[r].errors;
+        }
+
+        std::cout << "total\t" << totalRequests << '\t' << totalErrors << '\t' << static_cast<double>(totalRequests) / seconds << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const auto options = parseOptions(argc, argv);
+
+        prepareAppRoot(options);
+        const auto targets = seed(options);
+        const auto routeList = routes(targets);
+
+        Markdown::init();
+
+        const auto config = (fs::path(options.resources) / "wt_config.xml").string();
+        const auto approot = options.approot + "/";
+
+        std::vector<std::string> serverArguments = {
+            argv[0],
+            "--docroot", options.docroot,
+            "--approot", approot,
+            "--config", config,
+            "--http-address", "127.0.0.1",
+            "--http-port", options.port
+        };
+
+        std::vector<char*> serverArgv;
+        for (auto& argument : serverArguments)
+            serverArgv.emplace_back(argument.data());
+
+        Wt::WServer server(static_cast<int>(serverArgv.size()), serverArgv.data(), WTHTTP_CONFIGURATION);
+        BlogServer blogServer { server };
+
+        if (!server.start())
+            throw std::runtime_error("Server failed to start");
+
+        std::cerr << "Seeded " << targets.editorHandles.size() << " editors, " << targets.postIds.size() << " posts, "
+            << targets.attachmentIds.size() << " attachments, running " << options.threads << " clients for "
+            << options.duration.count() << " s" << std::endl;
+
+        auto stats = drive(routeList, options);
+
+        server.stop();
+
+        report(routeList, stats, options.duration);
+        blogServer.logStatistics();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Load test failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Compares database-native full-text search with a naive LIKE scan on SQLite.
+ *
+ * Usage: cxxblog_search_bench <database file> [post count] [iterations]
+ *
+ * Database is seeded with generated posts if it does not contain any yet.
+ */
+
+#include "DatabaseSearch.h"
+
+#include "models/BasicSession.h"
+#include "models/Editor.h"
+#include "models/Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Dbo/FixedSqlConnectionPool.h>
+#include <Wt/Dbo/backend/Sqlite3.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::vector<std::string> g_Words = {
+        "template", "compiler", "allocator", "database", "transaction", "session", "widget", "resource",
+        "markdown", "expression", "parser", "iterator", "container", "algorithm", "pointer", "reference",
+        "thread", "mutex", "atomic", "lambda", "variant", "optional", "coroutine", "module",
+        "benchmark", "latency", "throughput", "cache", "index", "query", "render", "server"
+    };
+
+    const std::vector<std::string> g_Queries = { "template", "allocator transaction", "coroutine", "latency cache", "nonexistent" };
+
+    std::string generateText(std::mt19937& rng, std::size_t words)
+    {
+        std::uniform_int_distribution<std::size_t> distribution { 0u, g_Words.size() - 1u };
+        std::string text;
+
+        for (std::size_t i = 0u; i < words; ++i)
+        {
+            if (!text.empty())
+                text += (i % 12u == 0u) ? ".\n\n" : " ";
+
+            text += g_Words[distribution(rng)];
+        }
+
+        return text;
+    }
+
+    void seed(BasicSession& session, std::size_t postCount)
+    {
+        dbo::Transaction t { session };
+
+        if (session.query<int>("select count(1) from post").resultValue() > 0)
+            return;
+
+        std::cerr << "Seeding " << postCount << " posts..." << std::endl;
+
+        auto editor = session.addNew<Editor>();
+        editor.modify()->name = "Benchmark";
+        editor.modify()->handle = "benchmark";
+
+        std::mt19937 rng { 42u };
+
+        for (std::size_t i = 0u; i < postCount; ++i)
+        {
+            auto post = session.addNew<Post>().modify();
+
+            post->author = editor;
+            post->created = post->published = Wt::WDateTime::currentDateTime();
+            post->visibility = Post::Visibility::Published;
+            post->title = generateText(rng, 6u);
+            post->intro = generateText(rng, 40u);
+            post->content = generateText(rng, 800u);
+        }
+
+        t.commit();
+    }
+
+    template<typename Fn>
+    double measure(std::size_t iterations, Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0u; i < iterations; ++i)
+            fn();
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <database file> [post count] [iterations]" << std::endl;
+        return -1;
+    }
+
+    const std::size_t postCount = argc > 2 ? std::stoul(argv[2]) : 10000u;
+    const std::size_t iterations = argc > 3 ? std::stoul(argv[3]) : 50u;
+
+    try
+    {
+        auto backend { std::make_unique<dbo::backend::Sqlite3>(argv[1]) };
+        backend->setDateTimeStorage(dbo::SqlDateTimeType::DateTime, dbo::backend::DateTimeStorage::PseudoISO8601AsText);
+
+        dbo::FixedSqlConnectionPool pool { std::move(backend), 1 };
+        BasicSession session { pool };
+
+        try
+        {
+            session.createTables();
+        }
+        catch (const dbo::Exception&)
+        {
+            // Tables already exist.
+        }
+
+        seed(session, postCount);
+
+        DatabaseSearch search { DatabaseSearch::Dialect::SQLite };
+        search.initialize(session);
+
+        std::cout << "query\tfts [ms]\tlike [ms]\tfts results\tlike results" << std::endl;
+
+        for (const auto& query : g_Queries)
+        {
+            dbo::Transaction t { session };
+
+            std::size_t ftsResults = 0u;
+            std::size_t likeResults = 0u;
+
+            auto ftsTime = measure(iterations, [&]
+            {
+                ftsResults = search.search(session, query, 50u, false).size();
+            });
+
+            // Naive approach, matches only the first word, which is already enough to force a full scan.
+            const auto pattern = "%" + query.substr(0u, query.find(' ')) + "%";
+
+            auto likeTime = measure(iterations, [&]
+            {
+                auto results = session.query<long long>("select id from post")
+                    .where("title like ? or intro like ? or content like ?").bind(pattern).bind(pattern).bind(pattern)
+                    .where("visibility = ?").bind(Post::Visibility::Published)
+                    .orderBy("id desc")
+                    .limit(50)
+                    .resultList();
+
+                likeResults = results.size();
+            });
+
+            std::cout << query << '\t' << ftsTime << '\t' << likeTime << '\t' << ftsResults << '\t' << likeResults << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
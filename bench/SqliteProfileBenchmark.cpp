@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measures SQLite read/write throughput with default connection settings and with the production profile
+ * (ConnectionPool::sqliteProfile), using the same writer/reader pool split as the server.
+ *
+ * Usage: cxxblog_sqlite_bench <directory> [write transactions] [reads per thread] [reader threads]
+ *
+ * Each run creates a fresh database in the given directory.
+ */
+
+#include "models/BasicSession.h"
+#include "models/ConnectionPool.h"
+#include "models/Editor.h"
+#include "models/Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Dbo/backend/Sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const auto g_SeedPostCount = 1000u;
+
+    struct Result
+    {
+        double writesPerSecond = 0.0;
+        double mixedReadsPerSecond = 0.0;
+        double mixedWritesPerSecond = 0.0;
+        uint64_t failedReads = 0u;
+        uint64_t failedWrites = 0u;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double seconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    void addPost(BasicSession& session, const dbo::ptr<Editor>& editor, std::size_t index)
+    {
+        dbo::Transaction t { session };
+
+        auto post = session.addNew<Post>().modify();
+        post->author = editor;
+        post->created = post->published = Wt::WDateTime::currentDateTime();
+        post->visibility = Post::Visibility::Published;
+        post->title = "Benchmark post " + std::to_string(index);
+        post->intro = "Intro of benchmark post " + std::to_string(index);
+        post->content = std::string(2000u, 'x');
+
+        t.commit();
+    }
+
+    Result run(const std::string& path, bool tuned, std::size_t writes, std::size_t reads, std::size_t readerThreads)
+    {
+        for (const auto& suffix : { "", "-wal", "-shm" })
+            std::remove((path + suffix).c_str());
+
+        auto backend { std::make_unique<dbo::backend::Sqlite3>(path) };
+        backend->setDateTimeStorage(dbo::SqlDateTimeType::DateTime, dbo::backend::DateTimeStorage::PseudoISO8601AsText);
+
+        ConnectionPool::Options writerOptions;
+        writerOptions.size = 1u;
+
+        if (tuned)
+            writerOptions.setupStatements = ConnectionPool::sqliteProfile();
+
+        auto readerOptions = writerOptions;
+        readerOptions.size = readerThreads;
+        readerOptions.warmUp = readerThreads;
+        readerOptions.readOnly = true;
+
+        ConnectionPool writerPool { backend->clone(), writerOptions };
+        BasicSession writer { writerPool };
+        writer.createTables();
+
+        dbo::ptr<Editor> editor;
+        {
+            dbo::Transaction t { writer };
+            editor = writer.addNew<Editor>();
+            editor.modify()->name = "Benchmark";
+            editor.modify()->handle = "benchmark";
+        }
+
+        for (std::size_t i = 0u; i < g_SeedPostCount; ++i)
+            addPost(writer, editor, i);
+
+        ConnectionPool readerPool { std::move(backend), readerOptions };
+
+        Result result;
+
+        // Sequential write transactions, dominated by journal syncing.
+        auto start = Clock::now();
+
+        for (std::size_t i = 0u; i < writes; ++i)
+            addPost(writer, editor, g_SeedPostCount + i);
+
+        result.writesPerSecond = writes / seconds(Clock::now() - start);
+
+        // Readers running the posts list query while the writer keeps adding posts.
+        std::atomic<bool> readersDone { false };
+        std::atomic<uint64_t> failedReads { 0u };
+        uint64_t mixedWrites = 0u;
+
+        start = Clock::now();
+
+        std::thread writerThread([&]
+        {
+            while (!readersDone)
+            {
+                try
+                {
+                    addPost(writer, editor, g_SeedPostCount + writes + mixedWrites);
+                    ++mixedWrites;
+                }
+                catch (const std::exception&)
+                {
+                    ++result.failedWrites;
+                }
+            }
+        });
+
+        std::vector<std::thread> readerThreadsList;
+
+        for (std::size_t i = 0u; i < readerThreads; ++i)
+        {
+            readerThreadsList.emplace_back([&]
+            {
+                BasicSession session { readerPool };
+
+                for (std::size_t j = 0u; j < reads; ++j)
+                {
+                    try
+                    {
+                        dbo::Transaction t { session };
+
+                        session.query<std::tuple<long long, Wt::WString>>("select id, title from post")
+                            .where("visibility = ?").bind(Post::Visibility::Published)
+                            .orderBy("published desc, id desc")
+                            .limit(20)
+                            .resultList();
+                    }
+                    catch (const std::exception&)
+                    {
+                        ++failedReads;
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : readerThreadsList)
+            thread.join();
+
+        const auto elapsed = seconds(Clock::now() - start);
+
+        readersDone = true;
+        writerThread.join();
+
+        result.mixedReadsPerSecond = (reads * readerThreads - failedReads) / elapsed;
+        result.mixedWritesPerSecond = mixedWrites / elapsed;
+        result.failedReads = failedReads;
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <directory> [write transactions] [reads per thread] [reader threads]" << std::endl;
+        return -1;
+    }
+
+    const std::string directory = argv[1];
+    const std::size_t writes = argc > 2 ? std::stoul(argv[2]) : 500u;
+    const std::size_t reads = argc > 3 ? std::stoul(argv[3]) : 2000u;
+    const std::size_t readerThreads = argc > 4 ? std::stoul(argv[4]) : 4u;
+
+    try
+    {
+        std::cout << "profile\twrites/s\tmixed reads/s\tmixed writes/s\tfailed reads\tfailed writes" << std::endl;
+
+        for (auto tuned : { false, true })
+        {
+            const auto name = tuned ? "tuned" : "default";
+            const auto result = run(directory + "/sqlite-bench-" + name + ".sq3", tuned, writes, reads, readerThreads);
+
+            std::cout << name << '\t' << result.writesPerSecond << '\t' << result.mixedReadsPerSecond << '\t'
+                << result.mixedWritesPerSecond << '\t' << result.failedReads << '\t' << result.failedWrites << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
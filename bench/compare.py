@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+#
+# Compares Google Benchmark JSON results with a baseline and reports regressions.
+#
+# Usage:
+#   cxxblog_bench --benchmark_format=json --benchmark_out=current.json --benchmark_repetitions=5
+#   bench/compare.py bench/baseline.json current.json [--threshold 10]
+#   bench/compare.py bench/baseline.json current.json --update
+#
+# Exits with 1 when any benchmark got slower than the threshold (percent), or is missing from current results.
+# With repetitions, medians are compared. --update replaces the baseline with current results.
+
+import argparse
+import json
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+
+    results = {}
+
+    for benchmark in data.get('benchmarks', []):
+        # With repetitions, only aggregates are relevant, and of those only the median.
+        if benchmark.get('run_type') == 'aggregate':
+            if benchmark.get('aggregate_name') != 'median':
+                continue
+            name = benchmark['run_name']
+        elif any(b.get('run_type') == 'aggregate' for b in data['benchmarks']):
+            continue
+        else:
+            name = benchmark['name']
+
+        results[name] = (benchmark['real_time'], benchmark['time_unit'])
+
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Reports benchmark regressions against a baseline.')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=10.0, help='allowed slowdown in percent (default 10)')
+    parser.add_argument('--update', action='store_true', help='replace baseline with current results')
+    args = parser.parse_args()
+
+    if args.update:
+        shutil.copyfile(args.current, args.baseline)
+        print('Baseline updated from {}'.format(args.current))
+        return 0
+
+    try:
+        baseline = load(args.baseline)
+    except FileNotFoundError:
+        print('No baseline at {}, record one on the reference machine with --update'.format(args.baseline))
+        return 2
+
+    current = load(args.current)
+    regressions = 0
+
+    print('{:<50} {:>14} {:>14} {:>9}'.format('benchmark', 'baseline', 'current', 'change'))
+
+    for name, (baseTime, unit) in sorted(baseline.items()):
+        if name not in current:
+            print('{:<50} {:>11.1f} {:<2} {:>14} {:>9}'.format(name, baseTime, unit, 'missing', 'FAIL'))
+            regressions += 1
+            continue
+
+        currentTime, currentUnit = current[name]
+
+        if currentUnit != unit:
+            print('{:<50} time unit changed from {} to {}'.format(name, unit, currentUnit))
+            regressions += 1
+            continue
+
+        change = (currentTime - baseTime) / baseTime * 100.0 if baseTime > 0 else 0.0
+        status = 'FAIL' if change > args.threshold else ''
+        regressions += 1 if status else 0
+
+        print('{:<50} {:>11.1f} {:<2} {:>11.1f} {:<2} {:>+8.1f}% {}'.format(name, baseTime, unit, currentTime, unit, change, status))
+
+    for name in sorted(set(current) - set(baseline)):
+        print('{:<50} {:>14} {:>11.1f} {:<2} {:>9}'.format(name, 'new', current[name][0], current[name][1], ''))
+
+    if regressions:
+        print('\n{} benchmark(s) regressed by more than {}%'.format(regressions, args.threshold))
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -18,6 +18,27 @@ if (NOT cmark-gfm-project_POPULATED)
 
     FetchContent_Populate(cmark-gfm-project)
 
+    # Inline special characters live in process-wide tables. Each parse adds characters of its extensions (e.g. ~ of
+    # strikethrough) before parsing inlines and removes them afterwards, so parsers on other threads lose them
+    # midway. Parsing is patched to leave the tables alone and Markdown::init() registers the characters once,
+    # through cmark_parser_register_special_characters(), before any parsing starts.
+    set(CMARK_BLOCKS_SOURCE ${cmark-gfm-project_SOURCE_DIR}/src/blocks.c)
+    set(CMARK_SPECIAL_CHARACTERS_CALL "cmark_manage_extensions_special_characters\\(parser, *[a-z0-9]+\\);")
+    file(READ ${CMARK_BLOCKS_SOURCE} CMARK_BLOCKS)
+
+    if (NOT CMARK_BLOCKS MATCHES "cmark_parser_register_special_characters")
+        string(REGEX MATCHALL "${CMARK_SPECIAL_CHARACTERS_CALL}" CMARK_SPECIAL_CHARACTERS_CALLS "${CMARK_BLOCKS}")
+        list(LENGTH CMARK_SPECIAL_CHARACTERS_CALLS CMARK_SPECIAL_CHARACTERS_CALL_COUNT)
+
+        if (NOT CMARK_SPECIAL_CHARACTERS_CALL_COUNT EQUAL 2)
+            message(FATAL_ERROR "cmark-gfm blocks.c doesn't toggle special characters the way 0.29.0.gfm.0 does, review the patch in cmake/cmark-gfm.cmake")
+        endif()
+
+        string(REGEX REPLACE "${CMARK_SPECIAL_CHARACTERS_CALL}" "" CMARK_BLOCKS "${CMARK_BLOCKS}")
+        string(APPEND CMARK_BLOCKS "\nvoid cmark_parser_register_special_characters(cmark_parser *parser) {\n  cmark_manage_extensions_special_characters(parser, 1);\n}\n")
+        file(WRITE ${CMARK_BLOCKS_SOURCE} "${CMARK_BLOCKS}")
+    endif()
+
     include(GenerateExportHeader)
     include(CheckIncludeFile)
     include(CheckCSourceCompiles)
@@ -0,0 +1,21 @@
+include(FetchContent)
+
+FetchContent_Declare(
+    google-benchmark-project
+    GIT_REPOSITORY    https://github.com/google/benchmark.git
+    GIT_TAG           v1.8.3
+)
+
+FetchContent_GetProperties(google-benchmark-project)
+
+if (NOT google-benchmark-project_POPULATED)
+    FetchContent_Populate(google-benchmark-project)
+
+    # Only the library is needed, its own tests would pull googletest as well.
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_WERROR OFF CACHE BOOL "" FORCE)
+
+    add_subdirectory(${google-benchmark-project_SOURCE_DIR} ${google-benchmark-project_BINARY_DIR} EXCLUDE_FROM_ALL)
+endif()
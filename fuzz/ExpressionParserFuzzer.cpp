@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * libFuzzer target for ExpressionParser: parses and resolves arbitrary content with all expression functions,
+ * images are rendered by a stub context.
+ *
+ * Usage: cxxblog_fuzz_expressions -timeout=2 -rss_limit_mb=512 -max_len=65536 -dict=fuzz/expressions.dict <corpus dir>
+ */
+
+#include "ExpressionParser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    class FuzzContext
+        : public ExpressionParser::Context
+    {
+    public:
+        std::string image(const std::string& id, const std::string& caption) const override
+        {
+            return "<img src=\"attachment/" + id + "\" alt=\"" + caption + "\"/>";
+        }
+    };
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const std::string content { reinterpret_cast<const char*>(data), size };
+
+    ExpressionParser expParser;
+    if (expParser.parse(content))
+    {
+        const auto resolved = expParser.resolve(FuzzContext {});
+
+        // Resolved content must stay within the parser limit, anything else means unbounded expansion.
+        if (resolved.size() > std::max(ExpressionParser::MaxResolvedSize, content.size()) + 16u)
+            std::abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * libFuzzer target for the post rendering pipeline: markdown is rendered to HTML and expressions are resolved
+ * in the result, the same way post views and snapshots do.
+ *
+ * Usage: cxxblog_fuzz_markdown -timeout=2 -rss_limit_mb=1024 -max_len=65536 <corpus dir>
+ */
+
+#include "ExpressionParser.h"
+#include "Markdown.h"
+#include "OutputSink.h"
+
+#include <cstdint>
+#include <string>
+
+namespace
+{
+    class FuzzContext
+        : public ExpressionParser::Context
+    {
+    public:
+        std::string image(const std::string& id, const std::string& caption) const override
+        {
+            return "<figure>" + id + caption + "</figure>";
+        }
+    };
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    Markdown::init();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const std::string markdown { reinterpret_cast<const char*>(data), size };
+
+    const auto html = Markdown(markdown).render();
+
+    ExpressionParser expParser;
+    expParser.parse(html.view());
+
+    std::string content;
+    OutputSink out { content };
+    expParser.resolve(FuzzContext {}, out);
+
+    return 0;
+}
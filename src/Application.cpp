@@ -23,19 +23,80 @@
 #include <Wt/WEnvironment.h>
 #include <Wt/WServer.h>
 
+#include "Metrics.h"
+#include "QueryStats.h"
+
 #include "views/MainView.h"
 #include "views/LoadingWidget.h"
 
-Application::Application(const std::string& basePath, const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& dbConnectionPool)
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+    // Statistics labels of application events. Internal path is chosen by the client, so it's only mapped onto
+    // known routes, which keeps the number of labels fixed.
+    constexpr std::pair<std::string_view, const char*> g_RouteLabels[] = {
+        { "", "app:posts" },
+        { "post", "app:post" },
+        { "tag", "app:tag" },
+        { "search", "app:search" },
+        { "people", "app:people" },
+        { "about", "app:about" },
+        { "create-post", "app:create-post" },
+        { "job", "app:job" },
+        { "settings", "app:settings" }
+    };
+
+    const char* routeLabel(std::string_view path, std::string_view loginPath)
+    {
+        path.remove_prefix(std::min(path.find_first_not_of('/'), path.size()));
+        path = path.substr(0u, path.find('/'));
+
+        for (const auto& [route, label] : g_RouteLabels)
+        {
+            if (path == route)
+                return label;
+        }
+
+        return path == loginPath ? "app:login" : "app:other";
+    }
+}
+
+Application::Application(const std::string& basePath, const std::string& siteUrl, const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& dbConnectionPool, Wt::Dbo::SqlConnectionPool& dbReadConnectionPool)
     : Wt::WApplication(env)
-    , _session(basePath, dbConnectionPool)
+    , _session(basePath, siteUrl, dbConnectionPool, dbReadConnectionPool)
 {
+    if (!readConfigurationProperty("loginPath", _loginPath))
+        _loginPath = "login";
+
+    Metrics::instance().increment(Metrics::Counter::SessionsCreated);
+    QueryStats::Scope queryStats { "app:start" };
+
     auto theme = std::make_shared<Wt::WBootstrapTheme>();
     theme->setVersion(Wt::BootstrapVersion::v3);
     setTheme(theme);
 
     setLoadingIndicator(std::make_unique<LoadingWidget>());
 
+    // Let browsers and feed readers discover feeds.
+    addMetaLink(basePath + "feed/atom", "alternate", {}, {}, "application/atom+xml", {}, false);
+    addMetaLink(basePath + "feed/rss", "alternate", {}, {}, "application/rss+xml", {}, false);
+
     root()->addStyleClass("container");
     root()->addNew<MainView>(_session, dbConnectionPool);
 }
+
+Application::~Application()
+{
+    Metrics::instance().increment(Metrics::Counter::SessionsDestroyed);
+}
+
+void Application::notify(const Wt::WEvent& event)
+{
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Application };
+
+    QueryStats::Scope queryStats { routeLabel(internalPath(), _loginPath) };
+    Wt::WApplication::notify(event);
+}
@@ -26,8 +26,13 @@ class Application
     : public Wt::WApplication
 {
 public:
-    Application(const std::string& basePath, const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& dbConnectionPool);
+    Application(const std::string& basePath, const std::string& siteUrl, const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& dbConnectionPool, Wt::Dbo::SqlConnectionPool& dbReadConnectionPool);
+    ~Application() override;
+
+protected:
+    void notify(const Wt::WEvent& event) override;
 
 private:
     Session _session;
+    std::string _loginPath;
 };
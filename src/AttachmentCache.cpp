@@ -17,6 +17,7 @@
  */
 
 #include "AttachmentCache.h"
+#include "Metrics.h"
 
 #include <Wt/WApplication.h>
 
@@ -56,7 +57,11 @@ void AttachmentCache::set(const std::string& id, const std::vector<uint8_t>& dat
         std::copy(data.begin(), data.end(), it);
 
         std::scoped_lock<std::mutex> lock { _mutex };
-        _idMimeTypeMap[id] = mimeType;
+        auto& entry = _idEntryMap[id];
+
+        _bytes = _bytes - entry.size + data.size();
+        entry.mimeType = mimeType;
+        entry.size = data.size();
     }
     catch (const std::exception&)
     {
@@ -77,13 +82,23 @@ std::pair<std::string, std::vector<uint8_t>> AttachmentCache::get(const std::str
             std::vector<uint8_t> data { std::istream_iterator<char> { s }, std::istream_iterator<char> { }};
 
             std::scoped_lock<std::mutex> lock { _mutex };
-            if (auto it = _idMimeTypeMap.find(id); it != _idMimeTypeMap.end())
-                return std::make_pair(it->second, std::move(data));
+            if (auto it = _idEntryMap.find(id); it != _idEntryMap.end())
+            {
+                Metrics::instance().increment(Metrics::Counter::AttachmentCacheHits);
+                return std::make_pair(it->second.mimeType, std::move(data));
+            }
         }
     }
     catch (const std::exception&)
     {
     }
 
+    Metrics::instance().increment(Metrics::Counter::AttachmentCacheMisses);
     return std::make_pair(std::string{}, std::vector<uint8_t>{});
 }
+
+AttachmentCache::Usage AttachmentCache::usage() const
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+    return { _idEntryMap.size(), _bytes };
+}
@@ -28,6 +28,12 @@
 class AttachmentCache
 {
 public:
+    struct Usage
+    {
+        std::size_t entries = 0u;
+        uint64_t bytes = 0u;
+    };
+
     static AttachmentCache& instance();
 
     void invalidate() const;
@@ -36,9 +42,18 @@ public:
     void set(const std::string& id, const std::vector<uint8_t>& data, const std::string& mimeType);
     std::pair<std::string, std::vector<uint8_t>> get(const std::string& id) const;
 
+    Usage usage() const;
+
 private:
     AttachmentCache() = default;
 
+    struct Entry
+    {
+        std::string mimeType;
+        std::size_t size = 0u;
+    };
+
     mutable std::mutex _mutex;
-    std::map<std::string, std::string> _idMimeTypeMap;
+    std::map<std::string, Entry> _idEntryMap;
+    uint64_t _bytes = 0u;
 };
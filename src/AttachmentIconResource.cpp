@@ -18,6 +18,8 @@
 
 #include "AttachmentIconResource.h"
 #include "ApplicationExceptions.h"
+#include "Metrics.h"
+#include "QueryStats.h"
 
 #include "models/BasicSession.h"
 #include "models/Attachment.h"
@@ -42,6 +44,9 @@ AttachmentIconResource::~AttachmentIconResource()
 
 void AttachmentIconResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
 {
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::AttachmentIcon };
+    QueryStats::Scope queryStats { "resource:attachment-icon" };
+
     try
     {
         auto id = request.urlParam("id");
@@ -19,6 +19,8 @@
 #include "AttachmentResource.h"
 #include "ApplicationExceptions.h"
 #include "AttachmentCache.h"
+#include "Metrics.h"
+#include "QueryStats.h"
 
 #include "models/BasicSession.h"
 #include "models/Attachment.h"
@@ -38,6 +40,9 @@ AttachmentResource::~AttachmentResource()
 
 void AttachmentResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
 {
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Attachment };
+    QueryStats::Scope queryStats { "resource:attachment" };
+
     try
     {
         auto id = request.urlParam("id");
@@ -18,6 +18,8 @@
 
 #include "AvatarResource.h"
 #include "AvatarGenerator.h"
+#include "Metrics.h"
+#include "QueryStats.h"
 
 #include "models/BasicSession.h"
 #include "models/Editor.h"
@@ -38,6 +40,9 @@ AvatarResource::~AvatarResource()
 
 void AvatarResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
 {
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Avatar };
+    QueryStats::Scope queryStats { "resource:avatar" };
+
     try
     {
         auto handle = request.urlParam("handle");
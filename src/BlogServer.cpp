@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "BlogServer.h"
+#include "Application.h"
+
+#include "AvatarResource.h"
+#include "AttachmentCache.h"
+#include "AttachmentResource.h"
+#include "AttachmentIconResource.h"
+#include "FeedResource.h"
+#include "SnapshotResource.h"
+#include "SitemapIndex.h"
+#include "SitemapResource.h"
+#include "MetricsResource.h"
+#include "QueryLog.h"
+#include "RenderPool.h"
+#include "QueryStats.h"
+#include "SearchBackend.h"
+
+#include "models/SchemaManager.h"
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace
+{
+    DBConnectionInfo readConnectionInfo(Wt::WServer& server)
+    {
+        DBConnectionInfo dbConnectionInfo;
+        if (!server.readConfigurationProperty("dbType", dbConnectionInfo.dbType) || dbConnectionInfo.dbType.empty())
+            dbConnectionInfo.dbType = "sqlite";
+
+        if (dbConnectionInfo.dbType == "sqlite")
+        {
+            dbConnectionInfo.dbName = server.appRoot() + "database.sq3";
+        }
+        else
+        {
+            server.readConfigurationProperty("dbName", dbConnectionInfo.dbName);
+            server.readConfigurationProperty("dbUsername", dbConnectionInfo.dbUsername);
+            server.readConfigurationProperty("dbPassword", dbConnectionInfo.dbPassword);
+            server.readConfigurationProperty("dbHost", dbConnectionInfo.dbHost);
+            server.readConfigurationProperty("dbPort", dbConnectionInfo.dbPort);
+            server.readConfigurationProperty("dbReplicaHost", dbConnectionInfo.dbReplicaHost);
+            server.readConfigurationProperty("dbReplicaPort", dbConnectionInfo.dbReplicaPort);
+        }
+
+        return dbConnectionInfo;
+    }
+
+    std::size_t readSizeProperty(Wt::WServer& server, const std::string& name, std::size_t defaultValue)
+    {
+        std::string value;
+
+        if (!server.readConfigurationProperty(name, value) || value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos)
+            return defaultValue;
+
+        return static_cast<std::size_t>(std::stoul(value));
+    }
+
+    // Absolute URLs in feeds and static pages are built from this, never from request headers, so clients can't
+    // choose what ends up in shared caches.
+    std::string readSiteUrl(Wt::WServer& server)
+    {
+        std::string siteUrl;
+
+        if (server.readConfigurationProperty("siteUrl", siteUrl) && !siteUrl.empty())
+        {
+            while (!siteUrl.empty() && siteUrl.back() == '/')
+                siteUrl.pop_back();
+
+            return siteUrl;
+        }
+
+        char hostName[256] {};
+
+        if (gethostname(hostName, sizeof(hostName) - 1u) != 0 || hostName[0] == '\0')
+            std::strcpy(hostName, "localhost");
+
+        siteUrl = std::string { "http://" } + hostName;
+        std::cerr << "siteUrl is not configured, using " << siteUrl << " in absolute links." << std::endl;
+
+        return siteUrl;
+    }
+
+    void validateLoginPath(Wt::WServer& server)
+    {
+        std::string loginPath;
+        if (!server.readConfigurationProperty("loginPath", loginPath))
+            return;
+
+        if (loginPath.size() < 5)
+            throw std::runtime_error("Login path is too short");
+
+        for (const auto c : loginPath)
+        {
+            if (c == '-')
+                continue;
+
+            if (std::isalnum(c))
+                continue;
+
+            throw std::runtime_error("Login path contains forbidden characters. It can only contain alphanumeric characters and must have at least 5 characters.");
+        }
+    }
+}
+
+template<typename Resource, typename... Args>
+void BlogServer::addResource(const std::string& path, Args&&... args)
+{
+    auto resource = std::make_unique<Resource>(std::forward<Args>(args)...);
+    _server.addResource(resource.get(), _basePath + path);
+    _resources.emplace_back(std::move(resource));
+}
+
+BlogServer::BlogServer(Wt::WServer& server)
+    : _server(server)
+    , _siteUrl(readSiteUrl(server))
+{
+    validateLoginPath(_server);
+
+    auto dbConnectionInfo = readConnectionInfo(_server);
+
+    std::string searchBackend;
+    _server.readConfigurationProperty("searchBackend", searchBackend);
+    SearchBackend::select(searchBackend, dbConnectionInfo.dbType);
+
+    dbConnectionInfo.poolOptions.size = readSizeProperty(_server, "dbPoolSize", dbConnectionInfo.poolOptions.size);
+    dbConnectionInfo.poolOptions.warmUp = readSizeProperty(_server, "dbPoolWarmUp", dbConnectionInfo.poolOptions.warmUp);
+    dbConnectionInfo.poolOptions.acquireTimeout = std::chrono::milliseconds(readSizeProperty(_server, "dbPoolTimeout", dbConnectionInfo.poolOptions.acquireTimeout.count()));
+    dbConnectionInfo.readPoolSize = readSizeProperty(_server, "dbReadPoolSize", dbConnectionInfo.poolOptions.size);
+    dbConnectionInfo.replicaRetryDelay = std::chrono::seconds(readSizeProperty(_server, "dbReplicaRetryDelay", dbConnectionInfo.replicaRetryDelay.count()));
+
+    QueryLog::instance().configure(std::chrono::milliseconds(readSizeProperty(_server, "slowQueryThreshold", 100u)), readSizeProperty(_server, "slowQuerySampleRate", 1u));
+    RenderPool::instance().configure(readSizeProperty(_server, "renderThreads", 2u));
+    QueryStats::instance().configure(readSizeProperty(_server, "requestStatementThreshold", 50u));
+
+    AttachmentCache::instance().invalidate();
+    Session::initAuthServices();
+
+    // Writer pool is used by editors and startup tasks, which may modify the database. Stateless resources and
+    // pages shown to anonymous readers only read, so they use read pool (read-only connections for SQLite,
+    // replica with fall back to primary if configured, the writer pool otherwise).
+    _dbConnectionPools = Session::createConnectionPools(std::move(dbConnectionInfo));
+    auto& dbConnectionPool = *_dbConnectionPools.writer;
+    auto& dbReadConnectionPool = _dbConnectionPools.read();
+    auto& dbConsistentReadConnectionPool = _dbConnectionPools.consistentRead();
+
+    // Schema is created or migrated before any request is handled, failure here is fatal.
+    SchemaManager(_basePath, _siteUrl, dbConnectionPool).update();
+
+    try
+    {
+        BasicSession session { dbConnectionPool };
+        SearchBackend::instance().initialize(session);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to initialize search backend: " << e.what() << std::endl;
+    }
+
+    try
+    {
+        BasicSession session { dbConnectionPool };
+        dbo::Transaction t { session };
+
+        SiteConfig::load(session);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to load site configuration: " << e.what() << std::endl;
+    }
+
+    try
+    {
+        BasicSession session { dbConsistentReadConnectionPool };
+        dbo::Transaction t { session };
+
+        SitemapIndex::instance().initialize(session, _siteUrl + _basePath);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to initialize sitemap index: " << e.what() << std::endl;
+    }
+
+    // Register avatar stateless resource.
+    addResource<AvatarResource>("avatar/${handle}", dbReadConnectionPool);
+
+    // Register attachment preview stateless resource.
+    addResource<AttachmentIconResource>("attachment-icon/${id}", dbReadConnectionPool);
+
+    // Register attachment stateless resource.
+    addResource<AttachmentResource>("attachment/${id}", dbReadConnectionPool);
+
+    // Register feed stateless resources, so feed readers don't have to create application sessions.
+    addResource<FeedResource>("feed/atom", dbConsistentReadConnectionPool, _basePath, _siteUrl, FeedCache::Format::Atom);
+    addResource<FeedResource>("feed/rss", dbConsistentReadConnectionPool, _basePath, _siteUrl, FeedCache::Format::Rss);
+
+    // Register static page resources, anonymous readers and crawlers get plain HTML instead of application session.
+    addResource<SnapshotResource>("post/${id}", dbConsistentReadConnectionPool, _basePath, _siteUrl, SnapshotResource::Page::Post);
+    addResource<SnapshotResource>("posts", dbConsistentReadConnectionPool, _basePath, _siteUrl, SnapshotResource::Page::PostsList);
+
+    // Register sitemap stateless resources.
+    addResource<SitemapResource>("sitemap.xml");
+    addResource<SitemapResource>("sitemap/${part}");
+
+    // Register metrics resource, by default it can be scraped only locally.
+    std::string metricsAllowedAddresses;
+    if (!_server.readConfigurationProperty("metricsAllowedAddresses", metricsAllowedAddresses))
+        metricsAllowedAddresses = "127.0.0.1,::1";
+
+    std::vector<std::string> metricsAllowedAddressList;
+    std::istringstream metricsAllowedAddressStream { metricsAllowedAddresses };
+
+    for (std::string address; std::getline(metricsAllowedAddressStream, address, ',');)
+    {
+        address.erase(0u, address.find_first_not_of(' '));
+        address.erase(address.find_last_not_of(' ') + 1u);
+
+        if (!address.empty())
+            metricsAllowedAddressList.emplace_back(std::move(address));
+    }
+
+    std::vector<std::pair<std::string, const ConnectionPool*>> metricsPools { { "writer", &dbConnectionPool } };
+    if (_dbConnectionPools.reader)
+        metricsPools.emplace_back("reader", _dbConnectionPools.reader.get());
+
+    std::string metricsToken;
+    _server.readConfigurationProperty("metricsToken", metricsToken);
+
+    addResource<MetricsResource>("metrics", std::move(metricsPools), std::move(metricsAllowedAddressList), std::move(metricsToken));
+
+    // Register entry point for the application.
+    _server.addEntryPoint(Wt::EntryPointType::Application, [this, &dbConnectionPool, &dbReadConnectionPool](const Wt::WEnvironment& env)
+    {
+        return std::make_unique<Application>(_basePath, _siteUrl, env, dbConnectionPool, dbReadConnectionPool);
+    });
+}
+
+BlogServer::~BlogServer() = default;
+
+void BlogServer::logStatistics() const
+{
+    auto logMetrics = [](const char* name, const ConnectionPool& pool)
+    {
+        auto metrics = pool.metrics();
+        auto averageWait = metrics.acquisitions > 0u ? metrics.totalWait.count() / static_cast<long long>(metrics.acquisitions) : 0;
+
+        std::cerr << name << " connection pool: " << metrics.open << "/" << metrics.size << " open, peak in use " << metrics.peakInUse
+            << ", " << metrics.acquisitions << " acquisitions, " << metrics.timeouts << " timeouts, wait avg " << averageWait
+            << " us, max " << metrics.maxWait.count() << " us" << std::endl;
+    };
+
+    logMetrics("Writer", *_dbConnectionPools.writer);
+
+    if (_dbConnectionPools.reader)
+        logMetrics("Reader", *_dbConnectionPools.reader);
+
+    for (const auto& [label, stats] : QueryStats::instance().snapshot())
+    {
+        std::cerr << "Queries per request [" << label << "]: " << stats.statements.count << " requests, "
+            << stats.statements.sum << " statements, " << stats.rows.sum << " rows, " << stats.durationUs.sum << " us" << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/WServer.h>
+#include <Wt/WResource.h>
+
+#include "models/Session.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Sets up everything the blog needs on a configured Wt::WServer: database pools and schema, startup indexes,
+ * stateless resources and the application entry point. Used by main() and by tools running the server in-process,
+ * has to outlive the server run.
+ */
+class BlogServer
+{
+public:
+    explicit BlogServer(Wt::WServer& server);
+    ~BlogServer();
+
+    /**
+     * Writes connection pool and per-request query statistics to the log.
+     */
+    void logStatistics() const;
+
+private:
+    template<typename Resource, typename... Args>
+    void addResource(const std::string& path, Args&&... args);
+
+    Wt::WServer& _server;
+    const std::string _basePath = "/";
+    const std::string _siteUrl;
+
+    ConnectionPools _dbConnectionPools;
+    std::vector<std::unique_ptr<Wt::WResource>> _resources;
+};
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "DatabaseSearch.h"
+
+#include "models/Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+
+#include <cctype>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    using ResultRow = std::tuple<long long, double>;
+
+    /**
+     * Builds FTS5 query that matches all words from user input. Every word is quoted, so characters that have special
+     * meaning in FTS5 query syntax cannot cause a syntax error.
+     */
+    std::string sqliteMatchExpression(std::string_view query)
+    {
+        std::string expression;
+        std::string word;
+
+        auto flush = [&]
+        {
+            if (word.empty())
+                return;
+
+            if (!expression.empty())
+                expression += ' ';
+
+            expression += '"';
+            expression += word;
+            expression += '"';
+            word.clear();
+        };
+
+        for (auto c : query)
+        {
+            if (std::isspace(static_cast<unsigned char>(c)))
+                flush();
+            else if (c == '"')
+                word += "\"\"";
+            else
+                word += c;
+        }
+
+        flush();
+        return expression;
+    }
+}
+
+DatabaseSearch::DatabaseSearch(Dialect dialect)
+    : _dialect(dialect)
+{
+}
+
+DatabaseSearch::Dialect DatabaseSearch::dialectFromDbType(const std::string& dbType)
+{
+    if (dbType == "sqlite")
+        return Dialect::SQLite;
+
+    if (dbType == "postgres")
+        return Dialect::Postgres;
+
+    if (dbType == "mysql")
+        return Dialect::MySQL;
+
+    throw std::runtime_error("Unknown dbType property value");
+}
+
+void DatabaseSearch::initialize(dbo::Session& session)
+{
+    dbo::Transaction t { session };
+
+    switch (_dialect)
+    {
+        case Dialect::SQLite:
+        {
+            auto exists = session.query<int>("select count(1) from sqlite_master").where("type = 'table' and name = 'post_fts'").resultValue();
+
+            if (exists != 0)
+                break;
+
+            // External content table, so post content is not duplicated. Weights of title and intro are applied at query time.
+            session.execute("create virtual table post_fts using fts5(title, intro, content, content='post', content_rowid='id', tokenize='porter unicode61')");
+
+            session.execute("create trigger post_fts_insert after insert on post begin "
+                            "insert into post_fts(rowid, title, intro, content) values (new.id, new.title, new.intro, new.content); "
+                            "end");
+
+            session.execute("create trigger post_fts_delete after delete on post begin "
+                            "insert into post_fts(post_fts, rowid, title, intro, content) values ('delete', old.id, old.title, old.intro, old.content); "
+                            "end");
+
+            session.execute("create trigger post_fts_update after update of title, intro, content on post begin "
+                            "insert into post_fts(post_fts, rowid, title, intro, content) values ('delete', old.id, old.title, old.intro, old.content); "
+                            "insert into post_fts(rowid, title, intro, content) values (new.id, new.title, new.intro, new.content); "
+                            "end");
+
+            // Index posts that existed before the table was created.
+            session.execute("insert into post_fts(post_fts) values ('rebuild')");
+            break;
+        }
+        case Dialect::Postgres:
+        {
+            session.execute("alter table post add column if not exists search_vector tsvector generated always as ("
+                            "setweight(to_tsvector('english', coalesce(title, '')), 'A') || "
+                            "setweight(to_tsvector('english', coalesce(intro, '')), 'B') || "
+                            "setweight(to_tsvector('english', coalesce(content, '')), 'D')) stored");
+
+            session.execute("create index if not exists post_search_vector_index on post using gin(search_vector)");
+            break;
+        }
+        case Dialect::MySQL:
+        {
+            auto exists = session.query<int>("select count(1) from information_schema.statistics")
+                .where("table_schema = database() and table_name = 'post' and index_name = 'post_fulltext_index'")
+                .resultValue();
+
+            if (exists == 0)
+                session.execute("create fulltext index post_fulltext_index on post(title, intro, content)");
+
+            break;
+        }
+    }
+
+    t.commit();
+}
+
+void DatabaseSearch::update(const dbo::ptr<Post>&)
+{
+    // Nothing to do, database keeps search structures in sync with the post table.
+}
+
+void DatabaseSearch::remove(long long)
+{
+    // Nothing to do, database keeps search structures in sync with the post table.
+}
+
+std::vector<DatabaseSearch::Result> DatabaseSearch::search(dbo::Session& session, std::string_view query, std::size_t limit, bool includeHidden) const
+{
+    if (query.empty() || limit == 0u)
+        return {};
+
+    const std::string text { query };
+    dbo::Query<ResultRow> resultsQuery;
+
+    switch (_dialect)
+    {
+        case Dialect::SQLite:
+        {
+            auto expression = sqliteMatchExpression(text);
+            if (expression.empty())
+                return {};
+
+            // bm25() returns lower values for better matches.
+            resultsQuery = session.query<ResultRow>("select post.id, -bm25(post_fts, 3.0, 2.0, 1.0) from post_fts join post on post.id = post_fts.rowid")
+                .where("post_fts match ?").bind(expression);
+
+            if (!includeHidden)
+                resultsQuery.where("post.visibility = ?").bind(Post::Visibility::Published);
+
+            break;
+        }
+        case Dialect::Postgres:
+        {
+            resultsQuery = session.query<ResultRow>("select id, ts_rank(search_vector, plainto_tsquery('english', ?)) from post").bind(text)
+                .where("search_vector @@ plainto_tsquery('english', ?)").bind(text);
+
+            if (!includeHidden)
+                resultsQuery.where("visibility = ?").bind(Post::Visibility::Published);
+
+            break;
+        }
+        case Dialect::MySQL:
+        {
+            resultsQuery = session.query<ResultRow>("select id, match(title, intro, content) against (? in natural language mode) from post").bind(text)
+                .where("match(title, intro, content) against (? in natural language mode)").bind(text);
+
+            if (!includeHidden)
+                resultsQuery.where("visibility = ?").bind(Post::Visibility::Published);
+
+            break;
+        }
+    }
+
+    std::vector<Result> results;
+
+    for (const auto& row : resultsQuery.orderBy("2 desc, 1 desc").limit(static_cast<int>(limit)).resultList())
+        results.push_back({ std::get<0>(row), std::get<1>(row) });
+
+    return results;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include "SearchBackend.h"
+
+/**
+ * Search backend that uses full-text search built into the database: FTS5 virtual table for SQLite, tsvector column
+ * with GIN index for Postgres and FULLTEXT index for MySQL. Search structures are kept in sync by the database itself
+ * (triggers, generated column or index), so every write to the post table is reflected immediately.
+ */
+class DatabaseSearch
+    : public SearchBackend
+{
+public:
+    enum class Dialect
+    {
+        SQLite,
+        Postgres,
+        MySQL
+    };
+
+    explicit DatabaseSearch(Dialect dialect);
+
+    static Dialect dialectFromDbType(const std::string& dbType);
+
+    void initialize(dbo::Session& session) override;
+
+    void update(const dbo::ptr<Post>& post) override;
+    void remove(long long id) override;
+
+    [[nodiscard]] std::vector<Result> search(dbo::Session& session, std::string_view query, std::size_t limit, bool includeHidden) const override;
+
+private:
+    Dialect _dialect;
+};
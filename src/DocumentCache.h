@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Response body rendered once and served to all requests, along with its entity tag.
+ */
+struct CachedDocument
+{
+    std::string body;
+    std::string etag;
+};
+
+/**
+ * Documents rendered by stateless resources, shared by all requests. Cache is dropped as a whole by invalidate(),
+ * documents rendered while that happened are not stored, since they may already be outdated.
+ */
+template<typename Key>
+class DocumentCache
+{
+public:
+    using DocumentPtr = std::shared_ptr<const CachedDocument>;
+
+    /**
+     * Returns cached document (may be null) along with cache generation, which has to be passed back to set().
+     */
+    std::pair<DocumentPtr, uint64_t> get(const Key& key) const
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        if (auto it = _documents.find(key); it != _documents.end())
+            return { it->second, _generation };
+
+        return { nullptr, _generation };
+    }
+
+    void set(const Key& key, DocumentPtr document, uint64_t generation)
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        if (generation != _generation)
+            return;
+
+        if (_maxSize > 0u && _documents.size() >= _maxSize && _documents.find(key) == _documents.end())
+            _documents.clear();
+
+        _documents[key] = std::move(document);
+    }
+
+    void invalidate()
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        _documents.clear();
+        ++_generation;
+    }
+
+protected:
+    /**
+     * Number of kept documents is limited by maxSize, 0 means no limit.
+     */
+    explicit DocumentCache(std::size_t maxSize = 0u)
+        : _maxSize(maxSize)
+    { }
+
+private:
+    const std::size_t _maxSize;
+
+    mutable std::mutex _mutex;
+    std::map<Key, DocumentPtr> _documents;
+    uint64_t _generation = 0u;
+};
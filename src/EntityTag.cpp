@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "EntityTag.h"
+
+#include <functional>
+#include <sstream>
+
+std::string EntityTag::of(std::string_view content)
+{
+    std::ostringstream etag;
+    etag << '"' << std::hex << std::hash<std::string_view>{}(content) << '"';
+    return etag.str();
+}
+
+bool EntityTag::matches(std::string_view ifNoneMatch, std::string_view etag)
+{
+    while (true)
+    {
+        auto start = ifNoneMatch.find_first_not_of(" \t,");
+        if (start == std::string_view::npos)
+            return false;
+
+        ifNoneMatch.remove_prefix(start);
+
+        if (ifNoneMatch.front() == '*')
+            return true;
+
+        if (ifNoneMatch.substr(0u, 2u) == "W/")
+            ifNoneMatch.remove_prefix(2u);
+
+        if (ifNoneMatch.empty() || ifNoneMatch.front() != '"')
+            return false;
+
+        auto end = ifNoneMatch.find('"', 1u);
+        if (end == std::string_view::npos)
+            return false;
+
+        if (ifNoneMatch.substr(0u, end + 1u) == etag)
+            return true;
+
+        ifNoneMatch.remove_prefix(end + 1u);
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ * HTTP entity tags of cached documents.
+ */
+class EntityTag
+{
+public:
+    /**
+     * Strong entity tag of given content.
+     */
+    [[nodiscard]] static std::string of(std::string_view content);
+
+    /**
+     * Weak comparison against the list of entity tags in If-None-Match header, see RFC 7232.
+     */
+    [[nodiscard]] static bool matches(std::string_view ifNoneMatch, std::string_view etag);
+};
@@ -17,20 +17,179 @@
  */
 
 #include "ExpressionParser.h"
+#include "OutputSink.h"
 
-#include <stack>
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <functional>
+#include <numeric>
 
-std::vector<std::string> ExpressionParser::Expression::resolveArguments(const ArgumentList& args)
+namespace
+{
+    using ArgumentList = ExpressionParser::Expression::ArgumentList;
+    using Context = ExpressionParser::Context;
+
+    constexpr auto g_npos = std::string_view::npos;
+
+    std::string echoFunction(const ArgumentList& args, const Context& context)
+    {
+        std::string result;
+
+        for (const auto& arg : ExpressionParser::Expression::resolveArguments(args, context))
+        {
+            if (!result.empty())
+                result += " ";
+
+            result += arg;
+        }
+
+        return result;
+    }
+
+    std::string imageFunction(const ArgumentList& args, const Context& context)
+    {
+        auto values = ExpressionParser::Expression::resolveArguments(args, context);
+
+        if (values.empty() || values.front().find_first_not_of("0123456789") != std::string::npos)
+            return {};
+
+        std::string caption;
+
+        // Caption could contain commas, so remaining arguments are joined back.
+        if (values.size() > 1)
+            caption = std::accumulate(values.begin() + 2, values.end(), values[1], [](const auto& s1, const auto& s2) { return s1 + ", " + s2; });
+
+        return context.image(values.front(), caption);
+    }
+
+    struct FunctionEntry
+    {
+        std::string_view name;
+        ExpressionParser::Expression::ExpressionFunction function;
+    };
+
+    constexpr std::array<FunctionEntry, 2> g_Functions {{
+        { "echo", &echoFunction },
+        { "image", &imageFunction }
+    }};
+
+    constexpr std::size_t g_FunctionTableSize = 8u;
+
+    // Length with the first and the last character is enough to tell registered names apart.
+    constexpr std::size_t hashFunctionName(std::string_view name)
+    {
+        return name.empty() ? 0u : (name.size() + static_cast<unsigned char>(name.front()) * 3u + static_cast<unsigned char>(name.back())) % g_FunctionTableSize;
+    }
+
+    constexpr std::array<int, g_FunctionTableSize> buildFunctionTable()
+    {
+        std::array<int, g_FunctionTableSize> table {};
+
+        for (auto& slot : table)
+            slot = -1;
+
+        for (std::size_t i = 0u; i < g_Functions.size(); ++i)
+        {
+            auto& slot = table[hashFunctionName(g_Functions[i].name)];
+
+            // Hash collision makes this not a constant expression, so it fails the build instead of lookups.
+            if (slot != -1)
+                throw "Expression function names collide, adjust hashFunctionName";
+
+            slot = static_cast<int>(i);
+        }
+
+        return table;
+    }
+
+    // Perfect hash table built at compile time, shared by all parsers.
+    constexpr auto g_FunctionTable = buildFunctionTable();
+
+    ExpressionParser::Expression::ExpressionFunction findFunction(std::string_view name)
+    {
+        const auto index = g_FunctionTable[hashFunctionName(name)];
+
+        if (index < 0 || g_Functions[static_cast<std::size_t>(index)].name != name)
+            return nullptr;
+
+        return g_Functions[static_cast<std::size_t>(index)].function;
+    }
+
+    std::string_view::size_type find(std::string_view view, char c, std::string_view::size_type offset)
+    {
+        if (offset >= view.size())
+            return g_npos;
+
+        // memchr is vectorized by the C library, much faster than find_first_of with a set of characters.
+        auto found = static_cast<const char*>(std::memchr(view.data() + offset, c, view.size() - offset));
+        return found != nullptr ? static_cast<std::string_view::size_type>(found - view.data()) : g_npos;
+    }
+
+    /**
+     * Matches start and end tags in a single pass, calling onExpression(start, end, depth) for every expression,
+     * nested ones included, in order of their ends. Positions of the next start and end tag candidates are cached,
+     * so every character is looked at a constant number of times. Start tag without a matching end tag hides the
+     * rest of the view.
+     */
+    template<typename Callback>
+    void scanExpressions(std::string_view view, Callback onExpression)
+    {
+        auto nextStart = find(view, '$', 0u);
+        auto nextEnd = find(view, ')', 0u);
+
+        std::vector<std::string_view::size_type> starts;
+
+        while (starts.empty() ? nextStart != g_npos : nextEnd != g_npos)
+        {
+            if (nextStart < nextEnd)
+            {
+                const auto i = nextStart;
+                nextStart = find(view, '$', i + 1u);
+
+                // $ is escaped or not followed by (, skip it.
+                if ((i > 0u && view[i - 1u] == '\\') || (i + 1u) >= view.size() || view[i + 1u] != '(')
+                    continue;
+
+                starts.push_back(i);
+            }
+            else if (starts.empty())
+            {
+                // End tags outside of expressions don't matter, skip straight past the next start tag candidate.
+                nextEnd = find(view, ')', nextStart);
+            }
+            else
+            {
+                const auto i = nextEnd;
+                nextEnd = find(view, ')', i + 1u);
+
+                // This was escaped end tag, continue search.
+                if (view[i - 1u] == '\\')
+                    continue;
+
+                const auto start = starts.back();
+                starts.pop_back();
+
+                onExpression(start, i + 1u, starts.size());
+            }
+        }
+    }
+}
+
+std::vector<std::string> ExpressionParser::Expression::resolveArguments(const ArgumentList& args, const Context& context)
 {
     struct Visitor
     {
+        const Context& context;
+
         std::string operator()(const std::string& value) { return value; }
-        std::string operator()(const Expression& exp) { return exp.exec(); }
+        std::string operator()(const Expression& exp) { return exp.exec(context); }
     };
 
     std::vector<std::string> results;
-    Visitor v;
+    results.reserve(args.size());
+    Visitor v { context };
 
     for (const auto& arg : args)
         results.emplace_back(std::move(std::visit(v, arg)));
@@ -45,42 +204,18 @@ ExpressionParser::Expression::Expression(std::string::size_type start, std::stri
     this->end = end;
 }
 
-ExpressionParser::ExpressionParser()
-{
-    // Register default expressions.
-    registerFunction("echo", [](auto args)
-    {
-        std::string result;
-
-        for (const auto& arg : Expression::resolveArguments(args))
-        {
-            if (!result.empty())
-                result += " ";
-
-            result += arg;
-        }
-
-        return result;
-    });
-}
-
-void ExpressionParser::registerFunction(std::string name, Expression::ExpressionFunction function)
-{
-    assert(_functions.find(name) == _functions.end());
-    _functions.insert(std::make_pair(std::move(name), std::move(function)));
-}
-
 bool ExpressionParser::parse(std::string_view content)
 {
     _expressions.clear();
+    _nestedEnds.clear();
     _content = content;
 
-    std::string_view contentView { &_content[0], _content.size() };
-    auto expressions = findExpressions(contentView);
+    auto expressions = findExpressions(_content);
+    auto budget = std::max(MaxParseWork, 4u * _content.size());
 
     for (auto& exp : expressions)
     {
-        if (parseExpression(exp))
+        if (parseExpression(exp, 0u, budget))
         {
             _expressions.emplace_back(std::move(exp));
         }
@@ -89,61 +224,96 @@ bool ExpressionParser::parse(std::string_view content)
     return !_expressions.empty();
 }
 
-std::string ExpressionParser::resolve()
+std::string ExpressionParser::resolve(const Context& context) const
 {
     std::string content;
-    content.reserve(_content.size() * 2);
-    content.assign(_content);
+    content.reserve(_content.size() + _content.size() / 4u);
+
+    OutputSink out { content };
+    resolve(context, out);
+
+    return content;
+}
+
+void ExpressionParser::resolve(const Context& context, OutputSink& out) const
+{
+    const auto maxSize = std::max(MaxResolvedSize, _content.size());
+
+    std::string::size_type position = 0u;
+    std::size_t size = 0u;
 
-    // Resolve in reverse order - makes string substitution easy.
-    for (auto it = _expressions.rbegin(); it != _expressions.rend(); ++it)
+    for (const auto& exp : _expressions)
     {
-        const auto& exp = *it;
-        auto result = exp.exec();
-        content.replace(exp.start, exp.end - exp.start, result);
+        auto result = exp.exec(context);
+
+        if (size + (exp.start - position) + result.size() + (_content.size() - exp.end) > maxSize)
+            result = "#error#";
+
+        out << _content.substr(position, exp.start - position) << result;
+
+        size += (exp.start - position) + result.size();
+        position = exp.end;
     }
 
-    return content;
+    out << _content.substr(position);
 }
 
-bool ExpressionParser::parseExpression(Expression& exp) const
+std::vector<long long> ExpressionParser::imageAttachmentIds() const
 {
+    std::vector<long long> ids;
+
+    std::function<void(const Expression&)> collect = [&ids, &collect](const Expression& exp)
+    {
+        if (exp.function == &imageFunction && !exp.args.empty())
+        {
+            if (auto id = std::get_if<std::string>(&exp.args.front()); id != nullptr && !id->empty() && id->size() <= 18u && id->find_first_not_of("0123456789") == std::string::npos)
+                ids.emplace_back(std::stoll(*id));
+        }
+
+        for (const auto& arg : exp.args)
+        {
+            if (auto subExp = std::get_if<Expression>(&arg))
+                collect(*subExp);
+        }
+    };
+
+    for (const auto& exp : _expressions)
+        collect(exp);
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    return ids;
+}
+
+bool ExpressionParser::parseExpression(Expression& exp, std::size_t depth, std::size_t& budget) const
+{
+    if (depth >= MaxDepth || budget == 0u)
+        return false;
+
     // View for expression body, skipping starting and ending tags (hence + 2 and - 3).
     std::string_view expView { &_content[exp.start + 2], exp.end - exp.start - 3 };
 
     std::string_view::size_type j;
 
-    // First, extract function name.
-    std::string name;
-    name.reserve(32u);
-
-    for (j = 0u; j < expView.size(); ++j)
-    {
-        auto c = expView[j];
-
-        // Skip leading whitespaces.
-        if (name.empty() && std::isblank(c))
-            continue;
+    // First, extract function name, skipping leading whitespaces. Expression names can only be alphanumeric.
+    for (j = 0u; j < expView.size() && std::isblank(expView[j]); ++j)
+        ;
 
-        // Expression names can only be alphanumeric.
-        if (!std::isalnum(c))
-            break;
+    const auto nameStart = j;
 
-        name += c;
-    }
+    for (; j < expView.size() && std::isalnum(expView[j]); ++j)
+        ;
 
     // Expression cannot have empty name. If it does, simply return false.
-    if (name.empty())
+    if (j == nameStart)
         return false;
 
     // Check if function corresponding with expression name exists.
-    auto functionIt = _functions.find(name);
-    if (functionIt == _functions.end())
+    exp.function = findFunction(expView.substr(nameStart, j - nameStart));
+    if (exp.function == nullptr)
         return false;
 
-    // It does, copy it to expression object.
-    exp.function = functionIt->second;
-
     // Sanity check that let us skip some j == 0 checks.
     assert(j > 0u);
 
@@ -153,6 +323,11 @@ bool ExpressionParser::parseExpression(Expression& exp) const
 
     for (; j < expView.size(); ++j)
     {
+        if (budget == 0u)
+            return false;
+
+        --budget;
+
         auto c = expView[j];
 
         if (arg.empty())
@@ -163,16 +338,16 @@ bool ExpressionParser::parseExpression(Expression& exp) const
 
             if (c == '$' && expView[j - 1] != '\\' && (j + 1) < expView.size() && expView[j + 1] == '(')
             {
-                // We have a sub-expression as an argument. Try to extract it.
-                auto subExp = findNextExpression(expView, j);
+                // We have a sub-expression as an argument. Its end was matched while looking for expressions.
+                // + 2 is for starting tag of parent expression (it was skipped when expView was created).
+                const auto subStart = exp.start + 2 + j;
+                auto it = std::lower_bound(_nestedEnds.begin(), _nestedEnds.end(), subStart, [](const auto& entry, auto start) { return entry.first < start; });
 
-                if (subExp.valid())
+                if (it != _nestedEnds.end() && it->first == subStart)
                 {
-                    // Fix relative position to absolute position. + 2 is for starting tag of parent expression (it was skipped when expView was created).
-                    subExp.start += exp.start + 2;
-                    subExp.end += exp.start + 2;
+                    Expression subExp { subStart, it->second };
 
-                    if (parseExpression(subExp))
+                    if (parseExpression(subExp, depth + 1u, budget))
                     {
                         // Update current position past parsed sub-expression.
                         j += subExp.end - subExp.start + 1;
@@ -210,71 +385,20 @@ bool ExpressionParser::parseExpression(Expression& exp) const
     return true;
 }
 
-std::vector<ExpressionParser::Expression> ExpressionParser::findExpressions(const std::string_view& view, size_t offset) const
+std::vector<ExpressionParser::Expression> ExpressionParser::findExpressions(std::string_view view)
 {
     std::vector<Expression> expressions;
 
-    while (true)
+    scanExpressions(view, [this, &expressions](auto start, auto end, auto depth)
     {
-        auto exp { std::move(findNextExpression(view, offset)) };
-        if (!exp.valid())
-            break;
+        if (depth == 0u)
+            expressions.emplace_back(Expression { start, end });
+        else
+            _nestedEnds.emplace_back(start, end);
+    });
 
-        offset = exp.end;
-        expressions.emplace_back(std::move(exp));
-    }
+    // Nested expressions are reported in order of their ends, lookups go by start.
+    std::sort(_nestedEnds.begin(), _nestedEnds.end());
 
     return expressions;
 }
-
-ExpressionParser::Expression ExpressionParser::findNextExpression(const std::string_view& view, size_t offset) const
-{
-    std::vector<Expression> expressions;
-    std::stack<size_t> s;
-    std::string::size_type i = offset;
-
-    // Look for the first character of the starting tag or the last one. When found, they'll be put
-    // on a stack
-    while ((i = view.find_first_of("$)", i)) != std::string::npos)
-    {
-        switch (view[i])
-        {
-            case '$':
-            {
-                // $ is escaped, skip it.
-                if (i > 0 && view[i - 1] == '\\')
-                    break;
-
-                // Next character is not (, skip it.
-                if ((i + 1) >= view.size() || view[i + 1] != '(')
-                    break;
-
-                s.push(i);
-                break;
-            }
-            case ')':
-            {
-                // There was no matching start tag, skip it.
-                if (s.empty())
-                    break;
-
-                // This was escaped end tag, continue search.
-                if (i > 0 && view[i - 1] == '\\')
-                    break;
-
-                if (s.size() == 1u)
-                {
-                    // At this point we have matching start and end tags of top-level expression.
-                    return Expression { s.top(), i + 1 };
-                }
-
-                s.pop();
-                break;
-            }
-        }
-
-        ++i;
-    }
-
-    return Expression {};
-}
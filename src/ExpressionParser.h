@@ -19,27 +19,43 @@
 #pragma once
 
 #include <string>
+#include <utility>
 #include <vector>
-#include <map>
-#include <functional>
 #include <variant>
 #include <string_view>
 
+class OutputSink;
+
 class ExpressionParser
 {
 public:
+    /**
+     * Per-render state needed by expression functions, passed explicitly to resolve(), so function table can be
+     * shared by all parsers.
+     */
+    class Context
+    {
+    public:
+        virtual ~Context() = default;
+
+        /**
+         * Renders image stored as attachment with given id, caption may be empty.
+         */
+        [[nodiscard]] virtual std::string image(const std::string& attachmentId, const std::string& caption) const = 0;
+    };
+
     struct Expression
     {
         using ArgType = std::variant<std::string, Expression>;
         using ArgumentList = std::vector<ArgType>;
-        using ExpressionFunction = std::function<std::string(const ArgumentList&)>;
+        using ExpressionFunction = std::string(*)(const ArgumentList& args, const Context& context);
 
-        [[nodiscard]] inline std::string exec() const
+        [[nodiscard]] inline std::string exec(const Context& context) const
         {
-            return function != nullptr ? function(args) : std::string {"#error#"};
+            return function != nullptr ? function(args, context) : std::string {"#error#"};
         }
 
-        static std::vector<std::string> resolveArguments(const ArgumentList& args);
+        static std::vector<std::string> resolveArguments(const ArgumentList& args, const Context& context);
     private:
         friend class ExpressionParser;
 
@@ -49,25 +65,46 @@ public:
         std::string::size_type start = std::string::npos;
         std::string::size_type end = std::string::npos;
 
-        std::function<std::string(const ArgumentList&)> function;
+        ExpressionFunction function = nullptr;
         std::vector<std::variant<std::string, Expression>> args;
 
         [[nodiscard]] inline bool valid() const { return start != std::string::npos && end != std::string::npos; }
     };
 
-    ExpressionParser();
+    // Deeper sub-expressions are left as plain text, so hostile content cannot exhaust the stack.
+    static constexpr std::size_t MaxDepth = 16u;
+    // Upper bound of characters examined while parsing (unless four times the content size is larger). Failed
+    // sub-expressions are parsed again as plain text, so work is bounded separately from depth. Expressions
+    // left when it runs out stay as plain text.
+    static constexpr std::size_t MaxParseWork = 16u * 1024u * 1024u;
+    // Upper bound of resolved content size (unless the content itself is larger), results that would exceed it
+    // are replaced with an error marker.
+    static constexpr std::size_t MaxResolvedSize = 4u * 1024u * 1024u;
 
-    void registerFunction(std::string name, Expression::ExpressionFunction function);
+    /**
+     * Finds expressions in content, which has to outlive the parser. Returns true if there is any.
+     */
     bool parse(std::string_view content);
-    std::string resolve();
+    [[nodiscard]] std::string resolve(const Context& context) const;
+
+    /**
+     * Writes parsed content with expressions replaced by their results, chunk by chunk.
+     */
+    void resolve(const Context& context, OutputSink& out) const;
+
+    /**
+     * Returns sorted, unique attachment ids referenced by parsed image expressions, so they can be validated
+     * together before resolve(). Ids computed by nested expressions are not known before resolve() and are skipped.
+     */
+    [[nodiscard]] std::vector<long long> imageAttachmentIds() const;
 
 private:
-    std::map<std::string, Expression::ExpressionFunction> _functions;
     std::vector<Expression> _expressions;
 
-    [[nodiscard]] bool parseExpression(Expression& exp) const;
-    [[nodiscard]] std::vector<Expression> findExpressions(const std::string_view& view, size_t offset = 0u) const;
-    [[nodiscard]] Expression findNextExpression(const std::string_view& view, size_t offset = 0u) const;
+    [[nodiscard]] bool parseExpression(Expression& exp, std::size_t depth, std::size_t& budget) const;
+    [[nodiscard]] std::vector<Expression> findExpressions(std::string_view view);
 
     std::string_view _content;
+    // Start and end positions of nested expressions, sorted by start, so sub-expressions are not scanned again.
+    std::vector<std::pair<std::string::size_type, std::string::size_type>> _nestedEnds;
 };
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include "DocumentCache.h"
+
+enum class FeedFormat
+{
+    Atom,
+    Rss
+};
+
+/**
+ * Keeps serialized feeds shared by all requests. Feeds are generated lazily by FeedResource and dropped whenever
+ * a post is saved, published, hidden or deleted.
+ */
+class FeedCache
+    : public DocumentCache<FeedFormat>
+{
+public:
+    using Format = FeedFormat;
+    using FeedPtr = DocumentPtr;
+
+    static FeedCache& instance();
+
+private:
+    FeedCache() = default;
+};
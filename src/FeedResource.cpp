@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "FeedResource.h"
+#include "EntityTag.h"
+#include "RenderPool.h"
+#include "Metrics.h"
+#include "QueryStats.h"
+
+#include "models/BasicSession.h"
+#include "models/SiteConfig.h"
+#include "models/Editor.h"
+#include "models/Post.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/Utils.h>
+
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    constexpr auto g_MaxFeedEntries = 20;
+
+    std::string formatDate(const Wt::WDateTime& dateTime, const char* format)
+    {
+        auto time = dateTime.toTime_t();
+
+        std::tm tm {};
+        gmtime_r(&time, &tm);
+
+        char buffer[64];
+        return std::string(buffer, std::strftime(buffer, sizeof(buffer), format, &tm));
+    }
+
+    std::string xmlEncode(const std::string& text)
+    {
+        return Wt::Utils::htmlEncode(text);
+    }
+}
+
+FeedResource::FeedResource(dbo::SqlConnectionPool& connectionPool, std::string basePath, std::string siteUrl, FeedCache::Format format)
+    : _connectionPool(connectionPool)
+    , _basePath(std::move(basePath))
+    , _siteUrl(std::move(siteUrl))
+    , _format(format)
+{
+}
+
+FeedResource::~FeedResource()
+{
+    beingDeleted();
+}
+
+void FeedResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Feed };
+    QueryStats::Scope queryStats { _format == FeedCache::Format::Atom ? "resource:feed-atom" : "resource:feed-rss" };
+
+    try
+    {
+        auto [feed, generation] = FeedCache::instance().get(_format);
+
+        if (!feed)
+        {
+            feed = generate();
+            FeedCache::instance().set(_format, feed, generation);
+        }
+
+        response.addHeader("ETag", feed->etag);
+        response.addHeader("Cache-Control", "public, max-age=300");
+
+        if (EntityTag::matches(request.headerValue("If-None-Match"), feed->etag))
+        {
+            response.setStatus(304);
+            return;
+        }
+
+        response.setMimeType(_format == FeedCache::Format::Atom ? "application/atom+xml; charset=utf-8" : "application/rss+xml; charset=utf-8");
+        response.setStatus(200);
+        response.setContentLength(feed->body.size());
+        response.out().write(feed->body.data(), feed->body.size());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to serve feed: " << e.what() << std::endl;
+        response.setStatus(500);
+    }
+}
+
+FeedCache::FeedPtr FeedResource::generate() const
+{
+    BasicSession session { _connectionPool };
+    dbo::Transaction t { session };
+
+    auto siteName = xmlEncode(SiteConfig::current()->siteName());
+
+    auto posts = session.find<Post>()
+        .where("visibility = ?").bind(Post::Visibility::Published)
+        .orderBy("published desc")
+        .limit(g_MaxFeedEntries)
+        .resultList();
+
+    std::vector<std::string> intros;
+    for (const auto& post : posts)
+        intros.emplace_back(post->intro.toUTF8());
+
+    intros = RenderPool::instance().renderHTML(intros);
+
+    auto siteUrl = xmlEncode(_siteUrl + _basePath);
+    std::ostringstream out;
+
+    out << R"(<?xml version="1.0" encoding="utf-8"?>)" << '\n';
+
+    if (_format == FeedCache::Format::Atom)
+    {
+        auto updated = posts.empty() ? Wt::WDateTime::currentDateTime() : posts.front()->published;
+
+        out << R"(<feed xmlns="http://www.w3.org/2005/Atom">)" << '\n'
+            << "<title>" << siteName << "</title>\n"
+            << R"(<link href=")" << siteUrl << R"("/>)" << '\n'
+            << R"(<link rel="self" href=")" << siteUrl << R"(feed/atom"/>)" << '\n'
+            << "<id>" << siteUrl << "</id>\n"
+            << "<updated>" << formatDate(updated, "%Y-%m-%dT%H:%M:%SZ") << "</updated>\n";
+
+        auto intro = intros.cbegin();
+
+        for (const auto& post : posts)
+        {
+            auto postUrl = xmlEncode(_siteUrl + _basePath + post->url());
+            auto published = formatDate(post->published, "%Y-%m-%dT%H:%M:%SZ");
+
+            out << "<entry>\n"
+                << "<title>" << xmlEncode(post->title.toUTF8()) << "</title>\n"
+                << R"(<link href=")" << postUrl << R"("/>)" << '\n'
+                << "<id>" << postUrl << "</id>\n"
+                << "<published>" << published << "</published>\n"
+                << "<updated>" << published << "</updated>\n"
+                << "<author><name>" << xmlEncode(post->author->name.toUTF8()) << "</name></author>\n"
+                << R"(<summary type="html">)" << xmlEncode(*intro++) << "</summary>\n"
+                << "</entry>\n";
+        }
+
+        out << "</feed>\n";
+    }
+    else
+    {
+        out << R"(<rss version="2.0" xmlns:atom="http://www.w3.org/2005/Atom">)" << '\n'
+            << "<channel>\n"
+            << "<title>" << siteName << "</title>\n"
+            << "<link>" << siteUrl << "</link>\n"
+            << "<description>" << siteName << "</description>\n"
+            << R"(<atom:link rel="self" type="application/rss+xml" href=")" << siteUrl << R"(feed/rss"/>)" << '\n';
+
+        auto intro = intros.cbegin();
+
+        for (const auto& post : posts)
+        {
+            auto postUrl = xmlEncode(_siteUrl + _basePath + post->url());
+
+            out << "<item>\n"
+                << "<title>" << xmlEncode(post->title.toUTF8()) << "</title>\n"
+                << "<link>" << postUrl << "</link>\n"
+                << R"(<guid isPermaLink="true">)" << postUrl << "</guid>\n"
+                << "<pubDate>" << formatDate(post->published, "%a, %d %b %Y %H:%M:%S GMT") << "</pubDate>\n"
+                << "<description>" << xmlEncode(*intro++) << "</description>\n"
+                << "</item>\n";
+        }
+
+        out << "</channel>\n"
+            << "</rss>\n";
+    }
+
+    auto feed = std::make_shared<CachedDocument>();
+    feed->body = out.str();
+    feed->etag = EntityTag::of(feed->body);
+
+    return feed;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/WResource.h>
+#include <Wt/Dbo/SqlConnectionPool.h>
+
+#include "FeedCache.h"
+
+namespace dbo = Wt::Dbo;
+
+class FeedResource
+    : public Wt::WResource
+{
+public:
+    FeedResource(dbo::SqlConnectionPool& connectionPool, std::string basePath, std::string siteUrl, FeedCache::Format format);
+    ~FeedResource() override;
+
+private:
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+    FeedCache::FeedPtr generate() const;
+
+    dbo::SqlConnectionPool& _connectionPool;
+    const std::string _basePath;
+    const std::string _siteUrl;
+    const FeedCache::Format _format;
+};
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "ImageExpression.h"
+#include "StaticTemplate.h"
+
+#include "models/Attachment.h"
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/WString.h>
+#include <Wt/WWebWidget.h>
+#include <Wt/Utils.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Keeps number of bound parameters below the lowest limit of supported databases (999 for older SQLite).
+    const auto g_MaxIdsPerQuery = 500u;
+
+    /**
+     * Template split into literal parts around its placeholders once, rendering is only concatenation.
+     */
+    struct CompiledTemplate
+    {
+        enum class Placeholder
+        {
+            ImageLink,
+            Caption,
+            Unknown
+        };
+
+        std::vector<std::string> literals;
+        std::vector<Placeholder> placeholders;
+
+        explicit CompiledTemplate(const std::string& text)
+        {
+            std::string::size_type position = 0u;
+
+            while (true)
+            {
+                auto begin = text.find("${", position);
+                auto end = begin != std::string::npos ? text.find('}', begin) : std::string::npos;
+
+                if (end == std::string::npos)
+                {
+                    literals.emplace_back(text.substr(position));
+                    break;
+                }
+
+                literals.emplace_back(text.substr(position, begin - position));
+
+                auto placeholder = text.substr(begin + 2, end - begin - 2);
+                auto name = placeholder.substr(0, placeholder.find_first_of(" \t\r\n"));
+
+                if (name == "imageLink")
+                    placeholders.emplace_back(Placeholder::ImageLink);
+                else if (name == "caption")
+                    placeholders.emplace_back(Placeholder::Caption);
+                else
+                    placeholders.emplace_back(Placeholder::Unknown);
+
+                position = end + 1;
+            }
+        }
+    };
+}
+
+ImageExpression::ImageExpression(dbo::Session& session, const std::vector<long long>& attachmentIds)
+    : _session(session)
+{
+    load(attachmentIds);
+}
+
+bool ImageExpression::isImage(const std::string& attachmentId) const
+{
+    if (attachmentId.empty() || attachmentId.size() > 18u || attachmentId.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    const auto id = std::stoll(attachmentId);
+
+    if (_images.find(id) == _images.end())
+        load({ id });
+
+    return _images[id];
+}
+
+std::string ImageExpression::render(const std::string& imageLink, const std::string& captionHtml)
+{
+    // Message bundle is not reloaded at runtime, so the template can be compiled once for the process.
+    static const CompiledTemplate compiled { StaticTemplate::message("expressions.image") };
+
+    std::string result;
+    result.reserve(compiled.literals.front().size() * 2u + imageLink.size() * 2u + captionHtml.size());
+
+    for (std::size_t i = 0u; i < compiled.placeholders.size(); ++i)
+    {
+        result += compiled.literals[i];
+
+        switch (compiled.placeholders[i])
+        {
+            case CompiledTemplate::Placeholder::ImageLink:
+                result += imageLink;
+                break;
+            case CompiledTemplate::Placeholder::Caption:
+                result += captionHtml;
+                break;
+            case CompiledTemplate::Placeholder::Unknown:
+                break;
+        }
+    }
+
+    result += compiled.literals.back();
+    return result;
+}
+
+std::string ImageExpression::captionHtml(const std::string& caption)
+{
+    if (caption.empty())
+        return {};
+
+    auto text = Wt::WString::fromUTF8(caption);
+    const auto filtered = Wt::WWebWidget::removeScript(text) ? text.toUTF8() : Wt::Utils::htmlEncode(caption);
+
+    return "<span class=\"exp-caption\">" + filtered + "</span>";
+}
+
+void ImageExpression::load(const std::vector<long long>& attachmentIds) const
+{
+    std::vector<long long> ids;
+
+    for (auto id : attachmentIds)
+    {
+        // Unknown ids are remembered as missing, found ones are updated by the query below.
+        if (_images.emplace(id, false).second)
+            ids.emplace_back(id);
+    }
+
+    if (ids.empty())
+        return;
+
+    dbo::Transaction t { _session };
+
+    for (std::size_t offset = 0u; offset < ids.size(); offset += g_MaxIdsPerQuery)
+    {
+        const auto count = std::min<std::size_t>(g_MaxIdsPerQuery, ids.size() - offset);
+
+        std::string placeholders;
+        for (std::size_t i = 0u; i < count; ++i)
+            placeholders += i == 0u ? "?" : ", ?";
+
+        auto query = _session.query<long long>("select id from attachment")
+            .where("id in (" + placeholders + ")")
+            .where("\"mimeType\" like 'image/%'");
+
+        for (std::size_t i = 0u; i < count; ++i)
+            query.bind(ids[offset + i]);
+
+        for (auto id : query.resultList())
+            _images[id] = true;
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/Session.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dbo = Wt::Dbo;
+
+/**
+ * Validates and renders $(image ...) expressions of a single post. Attachment ids referenced by the post are
+ * checked with one query up front, so posts with many images cost one lookup instead of one per image.
+ */
+class ImageExpression
+{
+public:
+    ImageExpression(dbo::Session& session, const std::vector<long long>& attachmentIds);
+
+    /**
+     * Returns true if attachment exists and is an image. Ids not passed to the constructor (for ex. computed
+     * by nested expressions) are looked up one by one.
+     */
+    [[nodiscard]] bool isImage(const std::string& attachmentId) const;
+
+    /**
+     * Renders expressions.image template, caption is inserted as is and may be empty.
+     */
+    [[nodiscard]] static std::string render(const std::string& imageLink, const std::string& captionHtml);
+
+    /**
+     * Returns caption markup for render(), empty for empty caption. Caption is filtered the same way Wt::WText
+     * filters XHTML text, caption which isn't valid XHTML is shown as plain text.
+     */
+    [[nodiscard]] static std::string captionHtml(const std::string& caption);
+
+private:
+    void load(const std::vector<long long>& attachmentIds) const;
+
+    dbo::Session& _session;
+    mutable std::map<long long, bool> _images;
+};
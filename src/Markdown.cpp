@@ -17,49 +17,333 @@
  */
 
 #include "Markdown.h"
+#include "Metrics.h"
+#include "OutputSink.h"
 
 #include <cmark-gfm-core-extensions.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <vector>
 #include <cassert>
 
-void Markdown::init()
+namespace
 {
-    cmark_gfm_core_extensions_ensure_registered();
+    constexpr auto g_Alignment = alignof(std::max_align_t);
+    // First block is enough for a typical post, following ones double up to the maximum size.
+    constexpr std::size_t g_InitialBlockSize = 64u * 1024u;
+    constexpr std::size_t g_MaxBlockSize = 1024u * 1024u;
+    // Blocks over this size are released on reset, a single huge document shouldn't pin memory of the thread.
+    constexpr std::size_t g_MaxRetainedSize = 4u * 1024u * 1024u;
+    // Arenas kept per thread, more are needed only when documents are nested.
+    constexpr std::size_t g_MaxPooledArenas = 4u;
+
+    constexpr std::size_t alignSize(std::size_t size)
+    {
+        return (size + g_Alignment - 1u) & ~(g_Alignment - 1u);
+    }
+
+    /**
+     * Every allocation is preceded by its owner and size, so realloc and free work without any global state.
+     * Owner is null for allocations made outside of an arena scope, those come from malloc.
+     */
+    struct AllocationHeader
+    {
+        MarkdownArena* arena;
+        std::size_t size;
+    };
+
+    constexpr auto g_HeaderSize = alignSize(sizeof(AllocationHeader));
+
+    AllocationHeader* allocationHeader(void* ptr)
+    {
+        return reinterpret_cast<AllocationHeader*>(static_cast<char*>(ptr) - g_HeaderSize);
+    }
+
+    thread_local MarkdownArena* t_currentArena = nullptr;
+
+    /**
+     * Makes arena the target of cmark allocations for the duration of a parse or render.
+     */
+    class ArenaScope
+    {
+    public:
+        explicit ArenaScope(MarkdownArena* arena)
+            : _previous(t_currentArena)
+        {
+            t_currentArena = arena;
+        }
+
+        ~ArenaScope()
+        {
+            t_currentArena = _previous;
+        }
+
+    private:
+        MarkdownArena* _previous;
+    };
+
+    void* arenaCalloc(std::size_t count, std::size_t size);
+    void* arenaRealloc(void* ptr, std::size_t size);
+    void arenaFree(void* ptr);
+
+    cmark_mem g_ArenaMem { &arenaCalloc, &arenaRealloc, &arenaFree };
+
+    void attachExtensions(cmark_parser* parser)
+    {
+        for (auto name : { "table", "autolink", "strikethrough" })
+        {
+            if (auto extension = cmark_find_syntax_extension(name))
+                cmark_parser_attach_syntax_extension(parser, extension);
+        }
+    }
 }
 
-Markdown::Markdown(const std::string& markdown)
+// Added to the pinned cmark-gfm by cmake/cmark-gfm.cmake. Marks inline special characters of parser's extensions in
+// cmark's process-wide tables, which parsing itself no longer touches.
+extern "C" void cmark_parser_register_special_characters(cmark_parser* parser);
+
+/**
+ * Bump allocator for a single document. Freeing an allocation is a no-op, everything is released at once by reset().
+ * Growing the most recent allocation (cmark's string buffers do it all the time) happens in place.
+ */
+class MarkdownArena
 {
-    auto parser = std::unique_ptr<cmark_parser, void(*)(cmark_parser*)> { cmark_parser_new(CMARK_OPT_DEFAULT | CMARK_OPT_VALIDATE_UTF8), &cmark_parser_free };
-    assert(parser != nullptr);
+public:
+    MarkdownArena() = default;
+    MarkdownArena(const MarkdownArena&) = delete;
+    MarkdownArena& operator=(const MarkdownArena&) = delete;
 
-    if (auto extTable = cmark_find_syntax_extension("table"))
+    ~MarkdownArena()
     {
-        cmark_parser_attach_syntax_extension(parser.get(), extTable);
+        for (auto& block : _blocks)
+            std::free(block.data);
     }
 
-    if (auto extAutolink = cmark_find_syntax_extension("autolink"))
+    void* allocate(std::size_t size)
     {
-        cmark_parser_attach_syntax_extension(parser.get(), extAutolink);
+        const auto total = g_HeaderSize + alignSize(size);
+
+        while (_current < _blocks.size() && _blocks[_current].size - _blocks[_current].used < total)
+            ++_current;
+
+        if (_current == _blocks.size())
+        {
+            const auto blockSize = std::max(total, _blocks.empty() ? g_InitialBlockSize : std::min(_blocks.back().size * 2u, g_MaxBlockSize));
+            auto data = static_cast<char*>(std::malloc(blockSize));
+
+            if (data == nullptr)
+                std::abort();
+
+            _blocks.push_back({ data, blockSize, 0u });
+        }
+
+        auto& block = _blocks[_current];
+        auto allocation = block.data + block.used;
+        block.used += total;
+
+        *reinterpret_cast<AllocationHeader*>(allocation) = { this, size };
+        _last = allocation + g_HeaderSize;
+
+        return _last;
     }
 
-    if (auto extStrikethrough = cmark_find_syntax_extension("strikethrough"))
+    void* reallocate(void* ptr, std::size_t size)
     {
-        cmark_parser_attach_syntax_extension(parser.get(), extStrikethrough);
+        auto ownHeader = allocationHeader(ptr);
+
+        if (ptr == _last)
+        {
+            auto& block = _blocks[_current];
+            const auto end = static_cast<std::size_t>(static_cast<char*>(ptr) - block.data) + alignSize(size);
+
+            if (end <= block.size)
+            {
+                block.used = end;
+                ownHeader->size = size;
+                return ptr;
+            }
+        }
+
+        const auto oldSize = ownHeader->size;
+        auto result = allocate(size);
+        std::memcpy(result, ptr, std::min(oldSize, size));
+
+        return result;
     }
 
+    void reset()
+    {
+        std::size_t retained = 0u;
+        auto it = _blocks.begin();
+
+        for (; it != _blocks.end() && retained + it->size <= g_MaxRetainedSize; ++it)
+        {
+            retained += it->size;
+            it->used = 0u;
+        }
+
+        for (auto released = it; released != _blocks.end(); ++released)
+            std::free(released->data);
+
+        _blocks.erase(it, _blocks.end());
+        _current = 0u;
+        _last = nullptr;
+    }
+
+private:
+    struct Block
+    {
+        char* data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<Block> _blocks;
+    std::size_t _current = 0u;
+    void* _last = nullptr;
+};
+
+namespace
+{
+    void* arenaCalloc(std::size_t count, std::size_t size)
+    {
+        if (count != 0u && size > (std::numeric_limits<std::size_t>::max() - g_HeaderSize) / count)
+            std::abort();
+
+        size *= count;
+        void* result = nullptr;
+
+        if (t_currentArena != nullptr)
+        {
+            result = t_currentArena->allocate(size);
+        }
+        else
+        {
+            auto allocation = static_cast<char*>(std::malloc(g_HeaderSize + size));
+
+            if (allocation == nullptr)
+                std::abort();
+
+            *reinterpret_cast<AllocationHeader*>(allocation) = { nullptr, size };
+            result = allocation + g_HeaderSize;
+        }
+
+        return std::memset(result, 0, size);
+    }
+
+    void* arenaRealloc(void* ptr, std::size_t size)
+    {
+        if (ptr == nullptr)
+            return arenaCalloc(1u, size);
+
+        if (auto arena = allocationHeader(ptr)->arena)
+            return arena->reallocate(ptr, size);
+
+        auto allocation = static_cast<char*>(std::realloc(allocationHeader(ptr), g_HeaderSize + size));
+
+        if (allocation == nullptr)
+            std::abort();
+
+        reinterpret_cast<AllocationHeader*>(allocation)->size = size;
+        return allocation + g_HeaderSize;
+    }
+
+    void arenaFree(void* ptr)
+    {
+        if (ptr != nullptr && allocationHeader(ptr)->arena == nullptr)
+            std::free(allocationHeader(ptr));
+    }
+
+    std::vector<std::unique_ptr<MarkdownArena>>& arenaPool()
+    {
+        thread_local std::vector<std::unique_ptr<MarkdownArena>> pool;
+        return pool;
+    }
+}
+
+void Markdown::init()
+{
+    cmark_gfm_core_extensions_ensure_registered();
+
+    // Every parser uses the same extensions, so their characters are registered once, before threads start parsing.
+    auto parser = std::unique_ptr<cmark_parser, void(*)(cmark_parser*)> { cmark_parser_new(CMARK_OPT_DEFAULT), &cmark_parser_free };
+    attachExtensions(parser.get());
+    cmark_parser_register_special_characters(parser.get());
+}
+
+Markdown::Markdown(const std::string& markdown)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    auto& pool = arenaPool();
+
+    if (!pool.empty())
+    {
+        _arena = std::move(pool.back());
+        pool.pop_back();
+    }
+    else
+    {
+        _arena = std::make_unique<MarkdownArena>();
+    }
+
+    // Scope has to outlive the parser, it is freed at the end of the constructor.
+    ArenaScope scope { _arena.get() };
+
+    auto parser = std::unique_ptr<cmark_parser, void(*)(cmark_parser*)> { cmark_parser_new_with_mem(CMARK_OPT_DEFAULT | CMARK_OPT_VALIDATE_UTF8, &g_ArenaMem), &cmark_parser_free };
+    assert(parser != nullptr);
+
+    attachExtensions(parser.get());
+
     cmark_parser_feed(parser.get(), markdown.c_str(), markdown.size());
 
     _root = cmark_parser_finish(parser.get());
+
+    Metrics::instance().observe(Metrics::Timing::MarkdownParse, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
 }
 
 Markdown::~Markdown()
 {
-    cmark_node_free(_root);
+    // Whole AST lives in the arena, there is no need to walk it.
     _root = nullptr;
+    _arena->reset();
+
+    auto& pool = arenaPool();
+
+    if (pool.size() < g_MaxPooledArenas)
+        pool.emplace_back(std::move(_arena));
+}
+
+Markdown::Html::Html(char* data)
+    : _data(data, &free)
+    , _size(data != nullptr ? std::strlen(data) : 0u)
+{
+}
+
+Markdown::Html Markdown::render() const
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Nodes may allocate from the arena while rendering, output goes to malloc'd buffer owned by Html, which can
+    // outlive the document.
+    ArenaScope scope { _arena.get() };
+    Html html { cmark_render_html_with_mem(_root, CMARK_OPT_SMART | CMARK_OPT_VALIDATE_UTF8, nullptr, cmark_get_default_mem_allocator()) };
+    Metrics::instance().observe(Metrics::Timing::MarkdownRender, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+    return html;
 }
 
 std::string Markdown::renderHTML() const
 {
-    std::unique_ptr<char, void(*)(void*)> result = { cmark_render_html(_root, CMARK_OPT_SMART | CMARK_OPT_VALIDATE_UTF8, nullptr), &free };
-    return result != nullptr ? std::string { result.get() } : std::string{};
+    return std::string { render().view() };
+}
+
+void Markdown::renderHTML(OutputSink& out) const
+{
+    out << render().view();
 }
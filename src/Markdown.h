@@ -18,19 +18,48 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <cmark-gfm.h>
 
+class OutputSink;
+class MarkdownArena;
+
+/**
+ * Markdown document parsed by cmark-gfm. AST lives in a bump arena reused by documents parsed on the same thread,
+ * so parsing costs a few allocations and destruction only resets the arena.
+ */
 class Markdown
 {
 public:
+    /**
+     * HTML rendered by cmark, kept in cmark's own buffer, so it can be parsed and written out without copying.
+     */
+    class Html
+    {
+    public:
+        [[nodiscard]] std::string_view view() const { return { _data.get(), _size }; }
+
+    private:
+        friend class Markdown;
+
+        explicit Html(char* data);
+
+        std::unique_ptr<char, void(*)(void*)> _data;
+        std::size_t _size = 0u;
+    };
+
     static void init();
 
     explicit Markdown(const std::string& markdown);
     ~Markdown();
 
+    [[nodiscard]] Html render() const;
     [[nodiscard]] std::string renderHTML() const;
+    void renderHTML(OutputSink& out) const;
 
 private:
+    std::unique_ptr<MarkdownArena> _arena;
     cmark_node* _root = nullptr;
 };
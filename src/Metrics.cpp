@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    using AtomicCounter = std::atomic<uint64_t>;
+
+    struct AtomicHistogram
+    {
+        std::array<AtomicCounter, 13> buckets {};
+        AtomicCounter count {};
+        AtomicCounter sumUs {};
+
+        void add(std::chrono::microseconds duration)
+        {
+            const auto value = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+            const auto bucket = std::lower_bound(Metrics::BucketsUs.begin(), Metrics::BucketsUs.end(), value) - Metrics::BucketsUs.begin();
+
+            // Only the owning thread writes, relaxed ordering is enough for readers merging shards.
+            buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+            count.fetch_add(1u, std::memory_order_relaxed);
+            sumUs.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        void mergeInto(Metrics::Histogram& histogram) const
+        {
+            for (std::size_t i = 0u; i < buckets.size(); ++i)
+                histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+
+            histogram.count += count.load(std::memory_order_relaxed);
+            histogram.sumUs += sumUs.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+constexpr std::array<uint64_t, 12> Metrics::BucketsUs;
+
+// Aligned to avoid false sharing between shards of different threads.
+struct alignas(64) Metrics::Shard
+{
+    std::array<AtomicHistogram, EndpointCount> endpoints {};
+    std::array<AtomicHistogram, TimingCount> timings {};
+    std::array<AtomicCounter, CounterCount> counters {};
+};
+
+Metrics::RequestTimer::RequestTimer(Endpoint endpoint)
+    : _endpoint(endpoint)
+    , _start(std::chrono::steady_clock::now())
+{
+}
+
+Metrics::RequestTimer::~RequestTimer()
+{
+    Metrics::instance().observe(_endpoint, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start));
+}
+
+Metrics::Metrics() = default;
+Metrics::~Metrics() = default;
+
+Metrics& Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::increment(Counter counter)
+{
+    localShard().counters[static_cast<std::size_t>(counter)].fetch_add(1u, std::memory_order_relaxed);
+}
+
+void Metrics::observe(Endpoint endpoint, std::chrono::microseconds duration)
+{
+    localShard().endpoints[static_cast<std::size_t>(endpoint)].add(duration);
+}
+
+void Metrics::observe(Timing timing, std::chrono::microseconds duration)
+{
+    localShard().timings[static_cast<std::size_t>(timing)].add(duration);
+}
+
+Metrics::Snapshot Metrics::snapshot() const
+{
+    Snapshot snapshot;
+
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    for (const auto& shard : _shards)
+    {
+        for (std::size_t i = 0u; i < EndpointCount; ++i)
+            shard->endpoints[i].mergeInto(snapshot.endpoints[i]);
+
+        for (std::size_t i = 0u; i < TimingCount; ++i)
+            shard->timings[i].mergeInto(snapshot.timings[i]);
+
+        for (std::size_t i = 0u; i < CounterCount; ++i)
+            snapshot.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+const char* Metrics::name(Endpoint endpoint)
+{
+    switch (endpoint)
+    {
+    case Endpoint::Application: return "application";
+    case Endpoint::Avatar: return "avatar";
+    case Endpoint::Attachment: return "attachment";
+    case Endpoint::AttachmentIcon: return "attachment-icon";
+    case Endpoint::Feed: return "feed";
+    case Endpoint::Snapshot: return "snapshot";
+    case Endpoint::Sitemap: return "sitemap";
+    case Endpoint::Metrics: return "metrics";
+    }
+
+    return "unknown";
+}
+
+const char* Metrics::name(Timing timing)
+{
+    switch (timing)
+    {
+    case Timing::MarkdownParse: return "parse";
+    case Timing::MarkdownRender: return "render";
+    }
+
+    return "unknown";
+}
+
+Metrics::Shard& Metrics::localShard()
+{
+    thread_local Shard* localShard = nullptr;
+
+    if (localShard == nullptr)
+    {
+        auto shard = std::make_unique<Shard>();
+        localShard = shard.get();
+
+        std::scoped_lock<std::mutex> lock { _mutex };
+        _shards.emplace_back(std::move(shard));
+    }
+
+    return *localShard;
+}
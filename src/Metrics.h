@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Process wide counters and latency histograms. Every thread updates its own shard with relaxed atomic
+ * increments, so recording never takes a lock nor shares cache lines with other threads. Shards are merged only
+ * when a snapshot is taken, i.e. when metrics are scraped.
+ */
+class Metrics
+{
+public:
+    enum class Endpoint
+    {
+        Application,
+        Avatar,
+        Attachment,
+        AttachmentIcon,
+        Feed,
+        Snapshot,
+        Sitemap,
+        Metrics
+    };
+
+    enum class Counter
+    {
+        SessionsCreated,
+        SessionsDestroyed,
+        AttachmentCacheHits,
+        AttachmentCacheMisses,
+        ReplicaFallbacks
+    };
+
+    enum class Timing
+    {
+        MarkdownParse,
+        MarkdownRender
+    };
+
+    static constexpr std::size_t EndpointCount = 8u;
+    static constexpr std::size_t CounterCount = 5u;
+    static constexpr std::size_t TimingCount = 2u;
+
+    // Upper bounds of histogram buckets in microseconds, the last bucket is unbounded.
+    static constexpr std::array<uint64_t, 12> BucketsUs { 100u, 500u, 1000u, 5000u, 10000u, 25000u, 50000u, 100000u, 250000u, 500000u, 1000000u, 5000000u };
+
+    struct Histogram
+    {
+        std::array<uint64_t, 13> buckets {};
+        uint64_t count = 0u;
+        uint64_t sumUs = 0u;
+    };
+
+    struct Snapshot
+    {
+        std::array<Histogram, EndpointCount> endpoints;
+        std::array<Histogram, TimingCount> timings;
+        std::array<uint64_t, CounterCount> counters {};
+    };
+
+    /**
+     * Measures lifetime of the enclosing scope as handling time of a request to given endpoint.
+     */
+    class RequestTimer
+    {
+    public:
+        explicit RequestTimer(Endpoint endpoint);
+        ~RequestTimer();
+
+        RequestTimer(const RequestTimer&) = delete;
+        RequestTimer& operator=(const RequestTimer&) = delete;
+
+    private:
+        const Endpoint _endpoint;
+        const std::chrono::steady_clock::time_point _start;
+    };
+
+    static Metrics& instance();
+
+    void increment(Counter counter);
+    void observe(Endpoint endpoint, std::chrono::microseconds duration);
+    void observe(Timing timing, std::chrono::microseconds duration);
+
+    Snapshot snapshot() const;
+
+    static const char* name(Endpoint endpoint);
+    static const char* name(Timing timing);
+
+private:
+    struct Shard;
+
+    Metrics();
+    ~Metrics();
+
+    Shard& localShard();
+
+    mutable std::mutex _mutex;
+    // Shards are never released, threads of the server pool live as long as the process anyway.
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "MetricsResource.h"
+#include "AttachmentCache.h"
+#include "Metrics.h"
+#include "QueryStats.h"
+
+#include "models/ConnectionPool.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace
+{
+    template<std::size_t N, std::size_t M>
+    void writeHistogram(std::ostream& out, const std::string& name, const std::string& labels, const std::array<uint64_t, N>& bounds,
+        const std::array<uint64_t, M>& buckets, uint64_t count, double sum, double scale)
+    {
+        static_assert(M == N + 1, "Histogram has to have one unbounded bucket");
+
+        const auto separator = labels.empty() ? "" : ",";
+        uint64_t cumulative = 0u;
+
+        for (std::size_t i = 0u; i < N; ++i)
+        {
+            cumulative += buckets[i];
+            out << name << "_bucket{" << labels << separator << "le=\"" << bounds[i] * scale << "\"} " << cumulative << '\n';
+        }
+
+        out << name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << count << '\n';
+        out << name << "_sum{" << labels << "} " << sum << '\n';
+        out << name << "_count{" << labels << "} " << count << '\n';
+    }
+
+    // Label values are quoted, backslash, quote and line feed have to be escaped (Prometheus exposition format).
+    std::string escapeLabelValue(std::string_view value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+
+        for (auto c : value)
+        {
+            switch (c)
+            {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += c;
+                break;
+            }
+        }
+
+        return escaped;
+    }
+
+    void writeHeader(std::ostream& out, const std::string& name, const char* type, const char* help)
+    {
+        out << "# HELP " << name << ' ' << help << '\n';
+        out << "# TYPE " << name << ' ' << type << '\n';
+    }
+
+    long long residentMemoryBytes()
+    {
+        std::ifstream statm { "/proc/self/statm" };
+        long long size = 0, resident = 0;
+
+        if (!(statm >> size >> resident))
+            return -1;
+
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+}
+
+MetricsResource::MetricsResource(std::vector<std::pair<std::string, const ConnectionPool*>> pools, std::vector<std::string> allowedAddresses, std::string token)
+    : _pools(std::move(pools))
+    , _token(std::move(token))
+{
+    for (const auto& entry : allowedAddresses)
+    {
+        std::string_view text { entry };
+        AddressRange range;
+        bool isV4 = false;
+
+        auto slash = text.find('/');
+
+        if (!parseAddress(text.substr(0u, slash), range.address, isV4))
+        {
+            std::cerr << "Ignoring invalid metrics allowed address: " << entry << std::endl;
+            continue;
+        }
+
+        const auto maxPrefixLength = isV4 ? 32u : 128u;
+        auto prefixLength = maxPrefixLength;
+
+        if (slash != std::string_view::npos)
+        {
+            auto length = text.substr(slash + 1u);
+
+            if (length.empty() || length.size() > 3u || length.find_first_not_of("0123456789") != std::string_view::npos
+                || std::stoul(std::string { length }) > maxPrefixLength)
+            {
+                std::cerr << "Ignoring invalid metrics allowed address: " << entry << std::endl;
+                continue;
+            }
+
+            prefixLength = std::stoul(std::string { length });
+        }
+
+        range.prefixLength = prefixLength + (isV4 ? 96u : 0u);
+        _allowedRanges.push_back(range);
+    }
+}
+
+MetricsResource::~MetricsResource()
+{
+    beingDeleted();
+}
+
+void MetricsResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Metrics };
+
+    if (!isAllowed(request.clientAddress()) || !isAuthorized(request))
+    {
+        response.setStatus(403);
+        return;
+    }
+
+    const auto metrics = Metrics::instance().snapshot();
+    std::ostringstream out;
+
+    writeHeader(out, "cxxblog_http_request_duration_seconds", "histogram", "Time spent handling requests, per endpoint.");
+    for (std::size_t i = 0u; i < Metrics::EndpointCount; ++i)
+    {
+        const auto& histogram = metrics.endpoints[i];
+        const auto labels = std::string("endpoint=\"") + Metrics::name(static_cast<Metrics::Endpoint>(i)) + "\"";
+
+        writeHistogram(out, "cxxblog_http_request_duration_seconds", labels, Metrics::BucketsUs, histogram.buckets, histogram.count, histogram.sumUs / 1e6, 1e-6);
+    }
+
+    const auto sessionsCreated = metrics.counters[static_cast<std::size_t>(Metrics::Counter::SessionsCreated)];
+    const auto sessionsDestroyed = metrics.counters[static_cast<std::size_t>(Metrics::Counter::SessionsDestroyed)];
+
+    writeHeader(out, "cxxblog_sessions_active", "gauge", "Number of live application sessions.");
+    out << "cxxblog_sessions_active " << (sessionsCreated - sessionsDestroyed) << '\n';
+    writeHeader(out, "cxxblog_sessions_created_total", "counter", "Number of application sessions created.");
+    out << "cxxblog_sessions_created_total " << sessionsCreated << '\n';
+
+    writeHeader(out, "cxxblog_db_pool_connections", "gauge", "Database connections per pool and state.");
+    for (const auto& [name, pool] : _pools)
+    {
+        const auto poolMetrics = pool->metrics();
+        out << "cxxblog_db_pool_connections{pool=\"" << name << "\",state=\"max\"} " << poolMetrics.size << '\n';
+        out << "cxxblog_db_pool_connections{pool=\"" << name << "\",state=\"open\"} " << poolMetrics.open << '\n';
+        out << "cxxblog_db_pool_connections{pool=\"" << name << "\",state=\"in_use\"} " << poolMetrics.inUse << '\n';
+        out << "cxxblog_db_pool_connections{pool=\"" << name << "\",state=\"peak_in_use\"} " << poolMetrics.peakInUse << '\n';
+    }
+
+    writeHeader(out, "cxxblog_db_pool_acquisitions_total", "counter", "Connections handed out per pool.");
+    for (const auto& [name, pool] : _pools)
+        out << "cxxblog_db_pool_acquisitions_total{pool=\"" << name << "\"} " << pool->metrics().acquisitions << '\n';
+
+    writeHeader(out, "cxxblog_db_pool_timeouts_total", "counter", "Requests which timed out waiting for a connection.");
+    for (const auto& [name, pool] : _pools)
+        out << "cxxblog_db_pool_timeouts_total{pool=\"" << name << "\"} " << pool->metrics().timeouts << '\n';
+
+    writeHeader(out, "cxxblog_db_pool_wait_seconds_total", "counter", "Time spent waiting for a connection.");
+    for (const auto& [name, pool] : _pools)
+        out << "cxxblog_db_pool_wait_seconds_total{pool=\"" << name << "\"} " << pool->metrics().totalWait.count() / 1e6 << '\n';
+
+    writeHeader(out, "cxxblog_db_replica_fallbacks_total", "counter", "Reads sent to the primary because read replica was unavailable.");
+    out << "cxxblog_db_replica_fallbacks_total " << metrics.counters[static_cast<std::size_t>(Metrics::Counter::ReplicaFallbacks)] << '\n';
+
+    writeHeader(out, "cxxblog_sql_statements_per_request", "histogram", "SQL statements issued per request or application event.");
+    const auto queryStats = QueryStats::instance().snapshot();
+    for (const auto& [label, stats] : queryStats)
+    {
+        writeHistogram(out, "cxxblog_sql_statements_per_request", "label=\"" + escapeLabelValue(label) + "\"", QueryStats::StatementBuckets,
+            stats.statements.buckets, stats.statements.count, static_cast<double>(stats.statements.sum), 1.0);
+    }
+
+    writeHeader(out, "cxxblog_sql_duration_per_request_seconds", "histogram", "Time spent in SQL per request or application event.");
+    for (const auto& [label, stats] : queryStats)
+    {
+        writeHistogram(out, "cxxblog_sql_duration_per_request_seconds", "label=\"" + escapeLabelValue(label) + "\"", QueryStats::DurationBucketsUs,
+            stats.durationUs.buckets, stats.durationUs.count, stats.durationUs.sum / 1e6, 1e-6);
+    }
+
+    const auto cacheUsage = AttachmentCache::instance().usage();
+
+    writeHeader(out, "cxxblog_attachment_cache_requests_total", "counter", "Attachment cache lookups by result.");
+    out << "cxxblog_attachment_cache_requests_total{result=\"hit\"} " << metrics.counters[static_cast<std::size_t>(Metrics::Counter::AttachmentCacheHits)] << '\n';
+    out << "cxxblog_attachment_cache_requests_total{result=\"miss\"} " << metrics.counters[static_cast<std::size_t>(Metrics::Counter::AttachmentCacheMisses)] << '\n';
+    writeHeader(out, "cxxblog_attachment_cache_bytes", "gauge", "Size of cached attachments.");
+    out << "cxxblog_attachment_cache_bytes " << cacheUsage.bytes << '\n';
+    writeHeader(out, "cxxblog_attachment_cache_entries", "gauge", "Number of cached attachments.");
+    out << "cxxblog_attachment_cache_entries " << cacheUsage.entries << '\n';
+
+    writeHeader(out, "cxxblog_markdown_duration_seconds", "histogram", "Time spent parsing and rendering Markdown.");
+    for (std::size_t i = 0u; i < Metrics::TimingCount; ++i)
+    {
+        const auto& histogram = metrics.timings[i];
+        const auto labels = std::string("phase=\"") + Metrics::name(static_cast<Metrics::Timing>(i)) + "\"";
+
+        writeHistogram(out, "cxxblog_markdown_duration_seconds", labels, Metrics::BucketsUs, histogram.buckets, histogram.count, histogram.sumUs / 1e6, 1e-6);
+    }
+
+    if (auto rss = residentMemoryBytes(); rss >= 0)
+    {
+        writeHeader(out, "cxxblog_process_resident_memory_bytes", "gauge", "Resident memory size of the process.");
+        out << "cxxblog_process_resident_memory_bytes " << rss << '\n';
+    }
+
+    const auto body = out.str();
+
+    response.setMimeType("text/plain; version=0.0.4");
+    response.setStatus(200);
+    response.addHeader("Cache-Control", "no-store");
+    response.setContentLength(body.size());
+    response.out() << body;
+}
+
+bool MetricsResource::parseAddress(std::string_view text, std::array<uint8_t, 16>& address, bool& isV4)
+{
+    // Zone index of link-local addresses is not part of the address.
+    std::string value { text.substr(0u, text.find('%')) };
+
+    if (inet_pton(AF_INET6, value.c_str(), address.data()) == 1)
+    {
+        isV4 = false;
+        return true;
+    }
+
+    in_addr v4 {};
+
+    if (inet_pton(AF_INET, value.c_str(), &v4) != 1)
+        return false;
+
+    address.fill(0u);
+    address[10] = 0xff;
+    address[11] = 0xff;
+    std::memcpy(address.data() + 12, &v4, sizeof(v4));
+
+    isV4 = true;
+    return true;
+}
+
+bool MetricsResource::isAllowed(const std::string& clientAddress) const
+{
+    std::array<uint8_t, 16> address {};
+    bool isV4 = false;
+
+    if (!parseAddress(clientAddress, address, isV4))
+        return false;
+
+    for (const auto& range : _allowedRanges)
+    {
+        const auto bytes = range.prefixLength / 8u;
+        const auto bits = range.prefixLength % 8u;
+
+        if (std::memcmp(address.data(), range.address.data(), bytes) != 0)
+            continue;
+
+        if (bits > 0u && ((address[bytes] ^ range.address[bytes]) & (0xffu << (8u - bits)) & 0xffu) != 0u)
+            continue;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool MetricsResource::isAuthorized(const Wt::Http::Request& request) const
+{
+    // Without a token, only direct requests are trusted. Proxies add forwarding headers and their own address.
+    if (_token.empty())
+        return request.headerValue("X-Forwarded-For").empty() && request.headerValue("Forwarded").empty();
+
+    constexpr std::string_view prefix = "Bearer ";
+    const auto header = request.headerValue("Authorization");
+
+    if (header.size() != prefix.size() + _token.size() || header.compare(0u, prefix.size(), prefix) != 0)
+        return false;
+
+    // Compared in constant time, so the token can't be guessed character by character.
+    unsigned char difference = 0u;
+    for (std::size_t i = 0u; i < _token.size(); ++i)
+        difference |= static_cast<unsigned char>(header[prefix.size() + i] ^ _token[i]);
+
+    return difference == 0u;
+}
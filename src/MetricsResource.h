@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/WResource.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class ConnectionPool;
+
+/**
+ * Exposes Metrics, QueryStats, connection pool utilisation, attachment cache usage and process memory in
+ * Prometheus text format. Only clients with one of allowed addresses, or within one of allowed CIDR ranges, are
+ * served. If token is set, requests have to carry it as a bearer token as well, otherwise requests forwarded by
+ * a proxy are refused, since their client address is the proxy's one.
+ */
+class MetricsResource
+    : public Wt::WResource
+{
+public:
+    MetricsResource(std::vector<std::pair<std::string, const ConnectionPool*>> pools, std::vector<std::string> allowedAddresses, std::string token);
+    ~MetricsResource() override;
+
+protected:
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+private:
+    /**
+     * IPv4 addresses are kept as IPv4-mapped IPv6 ones, so both are compared the same way.
+     */
+    struct AddressRange
+    {
+        std::array<uint8_t, 16> address {};
+        std::size_t prefixLength = 0u;
+    };
+
+    static bool parseAddress(std::string_view text, std::array<uint8_t, 16>& address, bool& isV4);
+    bool isAllowed(const std::string& clientAddress) const;
+    bool isAuthorized(const Wt::Http::Request& request) const;
+
+    const std::vector<std::pair<std::string, const ConnectionPool*>> _pools;
+    std::vector<AddressRange> _allowedRanges;
+    const std::string _token;
+};
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * Destination of rendered HTML chunks. Renderers write pieces of the document as they produce them, either
+ * appending to a single buffer or straight to a stream (for ex. Http::Response::out()), so no intermediate
+ * copies of the whole document are needed.
+ */
+class OutputSink
+{
+public:
+    explicit OutputSink(std::string& buffer)
+        : _buffer(&buffer)
+    { }
+
+    explicit OutputSink(std::ostream& stream)
+        : _stream(&stream)
+    { }
+
+    OutputSink& operator<<(std::string_view chunk)
+    {
+        if (_buffer != nullptr)
+            _buffer->append(chunk);
+        else
+            _stream->write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+
+        return *this;
+    }
+
+    OutputSink& operator<<(char c)
+    {
+        return *this << std::string_view { &c, 1u };
+    }
+
+private:
+    std::string* _buffer = nullptr;
+    std::ostream* _stream = nullptr;
+};
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "QueryLog.h"
+
+#include <iostream>
+#include <sstream>
+
+QueryLog& QueryLog::instance()
+{
+    static QueryLog log;
+    return log;
+}
+
+void QueryLog::configure(std::chrono::milliseconds threshold, uint64_t sampleRate)
+{
+    _thresholdUs = std::chrono::duration_cast<std::chrono::microseconds>(threshold).count();
+    _sampleRate = sampleRate > 0u ? sampleRate : 1u;
+}
+
+void QueryLog::record(const std::string& sql, std::chrono::microseconds duration, uint64_t rows)
+{
+    if (duration.count() < _thresholdUs)
+        return;
+
+    const auto slowCount = ++_slowCount;
+    const auto sampleRate = _sampleRate.load();
+
+    if ((slowCount - 1u) % sampleRate != 0u)
+        return;
+
+    std::ostringstream line;
+    line << "{\"event\":\"slow_query\",\"duration_us\":" << duration.count()
+        << ",\"rows\":" << rows
+        << ",\"sample_rate\":" << sampleRate
+        << ",\"slow_total\":" << slowCount
+        << ",\"sql\":\"" << jsonEscape(sql) << "\"}\n";
+
+    // Single write, so concurrent records are not interleaved.
+    std::cerr << line.str() << std::flush;
+}
+
+std::string QueryLog::jsonEscape(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+
+    for (auto c : value)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += ' ';
+            else
+                result += c;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * Structured slow-query log. Statements taking longer than the threshold are written to the log as single line
+ * JSON records, sampled so a slow database does not flood the log. SQL is logged with placeholders only, bound
+ * values never reach the log.
+ */
+class QueryLog
+{
+public:
+    static QueryLog& instance();
+
+    /**
+     * Every sampleRate-th slow statement is logged, 1 logs all of them.
+     */
+    void configure(std::chrono::milliseconds threshold, uint64_t sampleRate);
+
+    void record(const std::string& sql, std::chrono::microseconds duration, uint64_t rows);
+
+    static std::string jsonEscape(const std::string& value);
+
+private:
+    QueryLog() = default;
+
+    std::atomic<int64_t> _thresholdUs { 100000 };
+    std::atomic<uint64_t> _sampleRate { 1u };
+    std::atomic<uint64_t> _slowCount { 0u };
+};
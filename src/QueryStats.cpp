@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "QueryStats.h"
+#include "QueryLog.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    thread_local QueryStats::Scope* g_CurrentScope = nullptr;
+}
+
+constexpr std::array<uint64_t, 9> QueryStats::StatementBuckets;
+constexpr std::array<uint64_t, 9> QueryStats::RowBuckets;
+constexpr std::array<uint64_t, 9> QueryStats::DurationBucketsUs;
+
+void QueryStats::Histogram::add(const std::array<uint64_t, 9>& bounds, uint64_t value)
+{
+    const auto bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+
+    ++buckets[bucket];
+    ++count;
+    sum += value;
+}
+
+QueryStats::Scope::Scope(std::string label)
+    : _label(std::move(label))
+    , _parent(g_CurrentScope)
+{
+    g_CurrentScope = this;
+}
+
+QueryStats::Scope::~Scope()
+{
+    g_CurrentScope = _parent;
+
+    // Nested scopes (e.g. resource served while an event is handled) are accounted to the outer one as well.
+    if (_parent != nullptr)
+    {
+        _parent->_statements += _statements;
+        _parent->_rows += _rows;
+        _parent->_duration += _duration;
+    }
+
+    QueryStats::instance().finish(*this);
+}
+
+QueryStats& QueryStats::instance()
+{
+    static QueryStats stats;
+    return stats;
+}
+
+void QueryStats::configure(uint64_t statementThreshold)
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+    _statementThreshold = statementThreshold;
+}
+
+void QueryStats::record(const std::string& sql, std::chrono::microseconds duration, uint64_t rows)
+{
+    auto scope = g_CurrentScope;
+
+    if (scope == nullptr)
+        return;
+
+    ++scope->_statements;
+    scope->_rows += rows;
+    scope->_duration += duration;
+    ++scope->_statementCounts[sql];
+}
+
+std::map<std::string, QueryStats::LabelStats> QueryStats::snapshot() const
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+    return _labelStats;
+}
+
+void QueryStats::finish(const Scope& scope)
+{
+    uint64_t statementThreshold = 0u;
+
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        auto& stats = _labelStats[scope._label];
+        stats.statements.add(StatementBuckets, scope._statements);
+        stats.rows.add(RowBuckets, scope._rows);
+        stats.durationUs.add(DurationBucketsUs, static_cast<uint64_t>(scope._duration.count()));
+
+        statementThreshold = _statementThreshold;
+    }
+
+    if (statementThreshold == 0u || scope._statements <= statementThreshold)
+        return;
+
+    auto mostRepeated = std::max_element(scope._statementCounts.begin(), scope._statementCounts.end(), [](const auto& a, const auto& b)
+    {
+        return a.second < b.second;
+    });
+
+    std::ostringstream line;
+    line << "{\"event\":\"request_queries\",\"label\":\"" << QueryLog::jsonEscape(scope._label)
+        << "\",\"statements\":" << scope._statements
+        << ",\"distinct\":" << scope._statementCounts.size()
+        << ",\"rows\":" << scope._rows
+        << ",\"duration_us\":" << scope._duration.count();
+
+    if (mostRepeated != scope._statementCounts.end())
+        line << ",\"most_repeated\":{\"count\":" << mostRepeated->second << ",\"sql\":\"" << QueryLog::jsonEscape(mostRepeated->first) << "\"}";
+
+    line << "}\n";
+    std::cerr << line.str() << std::flush;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Per request SQL accounting. A Scope is opened for every HTTP request handled by a stateless resource and for
+ * every Wt event, statements executed on the same thread are attributed to it. When the scope ends, its totals
+ * are added to histograms aggregated per label, and requests issuing suspiciously many statements are logged
+ * together with the most repeated one, which makes N+1 query patterns easy to spot.
+ */
+class QueryStats
+{
+public:
+    // Upper bounds of histogram buckets, the last bucket is unbounded.
+    static constexpr std::array<uint64_t, 9> StatementBuckets { 1u, 2u, 5u, 10u, 20u, 50u, 100u, 200u, 500u };
+    static constexpr std::array<uint64_t, 9> RowBuckets { 1u, 10u, 50u, 100u, 500u, 1000u, 5000u, 10000u, 50000u };
+    static constexpr std::array<uint64_t, 9> DurationBucketsUs { 1000u, 5000u, 10000u, 25000u, 50000u, 100000u, 250000u, 500000u, 1000000u };
+
+    struct Histogram
+    {
+        std::array<uint64_t, 10> buckets {};
+        uint64_t count = 0u;
+        uint64_t sum = 0u;
+
+        void add(const std::array<uint64_t, 9>& bounds, uint64_t value);
+    };
+
+    struct LabelStats
+    {
+        Histogram statements;
+        Histogram rows;
+        Histogram durationUs;
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(std::string label);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        friend class QueryStats;
+
+        std::string _label;
+        Scope* _parent;
+
+        uint64_t _statements = 0u;
+        uint64_t _rows = 0u;
+        std::chrono::microseconds _duration { 0 };
+        std::unordered_map<std::string, uint64_t> _statementCounts;
+    };
+
+    static QueryStats& instance();
+
+    /**
+     * Requests issuing more statements than the threshold are logged, 0 disables logging.
+     */
+    void configure(uint64_t statementThreshold);
+
+    /**
+     * Attributes a statement to the scope open on the calling thread, if any.
+     */
+    static void record(const std::string& sql, std::chrono::microseconds duration, uint64_t rows);
+
+    std::map<std::string, LabelStats> snapshot() const;
+
+private:
+    QueryStats() = default;
+
+    void finish(const Scope& scope);
+
+    mutable std::mutex _mutex;
+    std::map<std::string, LabelStats> _labelStats;
+    uint64_t _statementThreshold = 50u;
+};
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "RenderPool.h"
+#include "Markdown.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace
+{
+    // Below this size handing documents over to workers costs more than rendering them.
+    constexpr auto g_MinParallelBatch = 4u;
+
+    /**
+     * Shared by the calling thread and helping workers, documents are claimed one by one. Workers which start
+     * after everything was claimed only touch the counter, so the batch outlives the call through shared_ptr.
+     */
+    struct Batch
+    {
+        explicit Batch(const std::vector<std::string>& documents)
+            : documents(documents)
+            , size(documents.size())
+            , results(documents.size())
+        { }
+
+        const std::vector<std::string>& documents;
+        const std::size_t size;
+        std::vector<std::string> results;
+
+        std::atomic<std::size_t> next { 0u };
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t completed = 0u;
+        std::exception_ptr error;
+
+        void work()
+        {
+            std::size_t done = 0u;
+
+            for (auto i = next++; i < size; i = next++)
+            {
+                try
+                {
+                    results[i] = Markdown(documents[i]).renderHTML();
+                }
+                catch (...)
+                {
+                    std::scoped_lock<std::mutex> lock { mutex };
+                    error = std::current_exception();
+                }
+
+                ++done;
+            }
+
+            if (done == 0u)
+                return;
+
+            std::scoped_lock<std::mutex> lock { mutex };
+            completed += done;
+
+            if (completed == size)
+                finished.notify_all();
+        }
+    };
+}
+
+RenderPool& RenderPool::instance()
+{
+    static RenderPool pool;
+    return pool;
+}
+
+RenderPool::~RenderPool()
+{
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+        _stopping = true;
+    }
+
+    _condition.notify_all();
+
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+void RenderPool::configure(std::size_t threads)
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+    _threadCount = threads;
+}
+
+std::vector<std::string> RenderPool::renderHTML(const std::vector<std::string>& documents)
+{
+    auto batch = std::make_shared<Batch>(documents);
+
+    std::size_t helpers = 0u;
+
+    if (documents.size() >= g_MinParallelBatch)
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        if (_threads.empty() && _threadCount > 0u)
+            start();
+
+        // Calling thread renders too, one helper per remaining document is enough.
+        helpers = std::min(_threads.size(), documents.size() - 1u);
+
+        for (std::size_t i = 0u; i < helpers; ++i)
+            _jobs.emplace([batch] { batch->work(); });
+    }
+
+    if (helpers > 0u)
+        _condition.notify_all();
+
+    batch->work();
+
+    std::unique_lock<std::mutex> lock { batch->mutex };
+    batch->finished.wait(lock, [&batch] { return batch->completed == batch->size; });
+
+    if (batch->error)
+        std::rethrow_exception(batch->error);
+
+    return std::move(batch->results);
+}
+
+void RenderPool::start()
+{
+    for (std::size_t i = 0u; i < _threadCount; ++i)
+        _threads.emplace_back([this] { run(); });
+}
+
+void RenderPool::run()
+{
+    while (true)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock { _mutex };
+            _condition.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+            if (_stopping)
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads rendering batches of markdown documents, used by pages listing many posts and by caches filled
+ * in one go. Each worker parses with its own thread-local Markdown arena. The calling thread takes part in its
+ * batch, so a batch finishes even when all workers are busy with other requests.
+ */
+class RenderPool
+{
+public:
+    static RenderPool& instance();
+
+    /**
+     * Sets number of worker threads, 0 renders everything on the calling thread. Workers are started on first use.
+     */
+    void configure(std::size_t threads);
+
+    /**
+     * Renders documents to HTML, results are in the order of documents.
+     */
+    [[nodiscard]] std::vector<std::string> renderHTML(const std::vector<std::string>& documents);
+
+private:
+    RenderPool() = default;
+    ~RenderPool();
+
+    void start();
+    void run();
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::queue<std::function<void()>> _jobs;
+    std::vector<std::thread> _threads;
+    std::size_t _threadCount = 2u;
+    bool _stopping = false;
+};
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SearchBackend.h"
+#include "SearchIndex.h"
+#include "DatabaseSearch.h"
+
+#include <stdexcept>
+
+SearchBackend& SearchBackend::instance()
+{
+    auto& backend = current();
+
+    if (backend == nullptr)
+        backend = std::make_unique<SearchIndex>();
+
+    return *backend;
+}
+
+void SearchBackend::select(const std::string& name, const std::string& dbType)
+{
+    if (name.empty() || name == "index")
+        current() = std::make_unique<SearchIndex>();
+    else if (name == "database")
+        current() = std::make_unique<DatabaseSearch>(DatabaseSearch::dialectFromDbType(dbType));
+    else
+        throw std::runtime_error("Unknown searchBackend property value");
+}
+
+std::unique_ptr<SearchBackend>& SearchBackend::current()
+{
+    static std::unique_ptr<SearchBackend> backend;
+    return backend;
+}
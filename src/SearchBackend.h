@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Wt/Dbo/ptr.h>
+
+namespace dbo = Wt::Dbo;
+
+class Post;
+
+/**
+ * Common interface for post search implementations. Backend is selected once at startup with select() and then shared
+ * by all sessions.
+ */
+class SearchBackend
+{
+public:
+    struct Result
+    {
+        long long id;
+        double score;
+    };
+
+    virtual ~SearchBackend() = default;
+
+    static SearchBackend& instance();
+
+    /**
+     * Selects backend by name: "index" for in-process index (default) or "database" for database-native full-text
+     * search of given database type. Must be called before the server is started.
+     */
+    static void select(const std::string& name, const std::string& dbType);
+
+    /**
+     * Creates or loads whatever structures backend needs. Safe to call multiple times.
+     */
+    virtual void initialize(dbo::Session& session) = 0;
+
+    virtual void update(const dbo::ptr<Post>& post) = 0;
+    virtual void remove(long long id) = 0;
+
+    [[nodiscard]] virtual std::vector<Result> search(dbo::Session& session, std::string_view query, std::size_t limit, bool includeHidden) const = 0;
+
+private:
+    static std::unique_ptr<SearchBackend>& current();
+};
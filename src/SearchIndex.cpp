@@ -0,0 +1,674 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SearchIndex.h"
+
+#include "models/Post.h"
+
+#include <Wt/WApplication.h>
+#include <Wt/Dbo/Session.h>
+#include <Wt/Dbo/Transaction.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr std::string_view g_IndexFileHeader = "cxxblog-search-index 1";
+
+    constexpr auto g_MaxTermLength = 64u;
+
+    // Superseded records are tolerated until they outnumber live ones, small logs are not worth rewriting.
+    constexpr std::size_t g_MinDeadRecords = 256u;
+
+    // BM25 parameters and field weights. Terms found in title and intro are considered more relevant than
+    // those found in content.
+    constexpr auto g_K1 = 1.2;
+    constexpr auto g_B = 0.75;
+    constexpr auto g_TitleWeight = 3.0;
+    constexpr auto g_IntroWeight = 2.0;
+    constexpr auto g_ContentWeight = 1.0;
+
+    inline bool isTermCharacter(char c)
+    {
+        const auto u = static_cast<unsigned char>(c);
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u >= 0x80u;
+    }
+
+    inline bool endsWith(const std::string& s, std::string_view suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    inline bool isVowel(char c)
+    {
+        return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' || c == 'y';
+    }
+
+    inline bool containsVowel(const std::string& s, std::string::size_type length)
+    {
+        return std::any_of(s.begin(), s.begin() + length, isVowel);
+    }
+
+    /**
+     * Light English stemmer, a subset of Porter's algorithm (plurals, -ed, -ing and a few derivational suffixes).
+     * Words containing non-ASCII characters are left untouched.
+     */
+    void stem(std::string& term)
+    {
+        if (term.size() <= 3u || std::any_of(term.begin(), term.end(), [](char c) { return static_cast<unsigned char>(c) >= 0x80u; }))
+            return;
+
+        if (endsWith(term, "sses") || endsWith(term, "ies"))
+            term.erase(term.size() - 2u);
+        else if (!endsWith(term, "ss") && !endsWith(term, "us") && endsWith(term, "s"))
+            term.erase(term.size() - 1u);
+
+        auto stripped = false;
+
+        if (endsWith(term, "eed"))
+        {
+            if (term.size() > 4u)
+                term.erase(term.size() - 1u);
+        }
+        else if (endsWith(term, "ed") && term.size() > 4u && containsVowel(term, term.size() - 2u))
+        {
+            term.erase(term.size() - 2u);
+            stripped = true;
+        }
+        else if (endsWith(term, "ing") && term.size() > 5u && containsVowel(term, term.size() - 3u))
+        {
+            term.erase(term.size() - 3u);
+            stripped = true;
+        }
+
+        if (stripped)
+        {
+            const auto n = term.size();
+
+            if (endsWith(term, "at") || endsWith(term, "bl") || endsWith(term, "iz"))
+                term += 'e';
+            else if (n >= 2u && term[n - 1] == term[n - 2] && !isVowel(term[n - 1]) && term[n - 1] != 'l' && term[n - 1] != 's' && term[n - 1] != 'z')
+                term.erase(n - 1);
+        }
+
+        static constexpr std::pair<std::string_view, std::string_view> g_Suffixes[] = {
+            { "ational", "ate" },
+            { "ization", "ize" },
+            { "fulness", "ful" },
+            { "ousness", "ous" },
+            { "iveness", "ive" },
+            { "ation", "ate" },
+            { "ness", "" },
+            { "ment", "" },
+        };
+
+        for (const auto& [suffix, replacement] : g_Suffixes)
+        {
+            if (term.size() > suffix.size() + 2u && endsWith(term, suffix))
+            {
+                term.replace(term.size() - suffix.size(), suffix.size(), replacement);
+                break;
+            }
+        }
+    }
+}
+
+std::vector<std::string> SearchIndex::tokenize(std::string_view text)
+{
+    std::vector<std::string> terms;
+    std::string term;
+
+    auto flush = [&]
+    {
+        if (!term.empty() && term.size() <= g_MaxTermLength)
+        {
+            stem(term);
+            terms.emplace_back(std::move(term));
+        }
+
+        term.clear();
+    };
+
+    for (auto c : text)
+    {
+        if (isTermCharacter(c))
+            term += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        else
+            flush();
+    }
+
+    flush();
+    return terms;
+}
+
+std::string SearchIndex::indexPath() const
+{
+    return Wt::WApplication::appRoot() + "index" + fs::path::preferred_separator + "posts.idx";
+}
+
+void SearchIndex::initialize(dbo::Session& session)
+{
+    loadFile();
+
+    dbo::Transaction t { session };
+    auto postCount = session.query<long long>("select count(1) from post").resultValue();
+
+    if (static_cast<std::size_t>(postCount) != size())
+        rebuild(session);
+}
+
+void SearchIndex::update(const dbo::ptr<Post>& post)
+{
+    update(post.id(), post->visibility == Post::Visibility::Published, post->title.toUTF8(), post->intro.toUTF8(), post->content.toUTF8());
+}
+
+void SearchIndex::loadFile()
+{
+    std::unique_lock<std::shared_mutex> lock { _mutex };
+
+    reset();
+
+    try
+    {
+        std::ifstream s { indexPath() };
+        std::string line;
+
+        if (!std::getline(s, line) || line != g_IndexFileHeader)
+            return;
+
+        // Replay the log, later records override earlier ones.
+        while (std::getline(s, line))
+        {
+            std::istringstream record { line };
+            char type;
+            long long id;
+
+            if (!(record >> type >> id))
+                continue;
+
+            if (type == 'D')
+            {
+                erase(id);
+            }
+            else if (type == 'U')
+            {
+                int published;
+                Document document;
+
+                if (!(record >> published >> document.titleLength >> document.introLength))
+                    continue;
+
+                document.published = published != 0;
+
+                // Previous version goes first, so terms only it used are released before they're looked up again.
+                erase(id);
+
+                std::string term;
+                while (record >> term)
+                    document.terms.push_back(termId(term));
+
+                insert(id, std::move(document));
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to load search index: " << e.what() << std::endl;
+    }
+
+    persist(lock);
+}
+
+void SearchIndex::update(long long id, bool published, std::string_view title, std::string_view intro, std::string_view content)
+{
+    auto titleTerms = tokenize(title);
+    auto introTerms = tokenize(intro);
+    auto contentTerms = tokenize(content);
+
+    std::unique_lock<std::shared_mutex> lock { _mutex };
+
+    // Previous version goes first, so terms only it used are released before they're looked up again.
+    erase(id);
+
+    auto document = makeDocument(published, titleTerms, introTerms, contentTerms);
+    auto record = serialize(id, document);
+
+    insert(id, std::move(document));
+    persist(lock, record);
+}
+
+void SearchIndex::remove(long long id)
+{
+    std::unique_lock<std::shared_mutex> lock { _mutex };
+
+    erase(id);
+    persist(lock, "D " + std::to_string(id));
+}
+
+void SearchIndex::clear()
+{
+    std::unique_lock<std::shared_mutex> lock { _mutex };
+
+    reset();
+    persist(lock);
+}
+
+void SearchIndex::reset()
+{
+    _termIds.clear();
+    _terms.clear();
+    _postings.clear();
+    _freeTermIds.clear();
+    _documents.clear();
+    _totalLength = 0u;
+}
+
+std::size_t SearchIndex::size() const
+{
+    std::shared_lock<std::shared_mutex> lock { _mutex };
+    return _documents.size();
+}
+
+std::vector<SearchIndex::Result> SearchIndex::search(dbo::Session&, std::string_view query, std::size_t limit, bool includeHidden) const
+{
+    return search(query, limit, includeHidden);
+}
+
+std::vector<SearchIndex::Result> SearchIndex::search(std::string_view query, std::size_t limit, bool includeHidden) const
+{
+    // Split query into free terms and quoted phrases.
+    std::vector<std::string> terms;
+    std::vector<std::vector<std::string>> phrases;
+
+    for (std::string_view::size_type pos = 0u, n = 0u; pos <= query.size(); ++n)
+    {
+        auto end = std::min(query.find('"', pos), query.size());
+        auto part = tokenize(query.substr(pos, end - pos));
+
+        if (n % 2u == 1u && part.size() > 1u)
+            phrases.push_back(part);
+
+        terms.insert(terms.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+        pos = end + 1u;
+    }
+
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    std::shared_lock<std::shared_mutex> lock { _mutex };
+
+    if (_documents.empty() || limit == 0u)
+        return {};
+
+    std::vector<std::vector<uint32_t>> phraseIds;
+
+    for (const auto& phrase : phrases)
+    {
+        auto& ids = phraseIds.emplace_back();
+
+        for (const auto& term : phrase)
+        {
+            auto it = _termIds.find(term);
+
+            // Phrase contains a term which does not appear anywhere, so it cannot be matched.
+            if (it == _termIds.end())
+                return {};
+
+            ids.push_back(it->second);
+        }
+    }
+
+    const auto documentCount = static_cast<double>(_documents.size());
+    const auto averageLength = std::max(1.0, static_cast<double>(_totalLength) / documentCount);
+
+    std::unordered_map<long long, double> scores;
+
+    for (const auto& term : terms)
+    {
+        auto termIt = _termIds.find(term);
+        if (termIt == _termIds.end())
+            continue;
+
+        const auto& postings = _postings[termIt->second];
+        if (postings.empty())
+            continue;
+
+        const auto df = static_cast<double>(postings.size());
+        const auto idf = std::log(1.0 + (documentCount - df + 0.5) / (df + 0.5));
+
+        for (const auto& posting : postings)
+        {
+            const auto& document = _documents.at(posting.id);
+
+            if (!includeHidden && !document.published)
+                continue;
+
+            auto tf = 0.0;
+            for (auto position : posting.positions)
+            {
+                if (position < document.titleLength)
+                    tf += g_TitleWeight;
+                else if (position < document.titleLength + document.introLength)
+                    tf += g_IntroWeight;
+                else
+                    tf += g_ContentWeight;
+            }
+
+            const auto length = static_cast<double>(document.terms.size());
+            scores[posting.id] += idf * (tf * (g_K1 + 1.0)) / (tf + g_K1 * (1.0 - g_B + g_B * length / averageLength));
+        }
+    }
+
+    std::vector<Result> results;
+    results.reserve(scores.size());
+
+    for (const auto& [id, score] : scores)
+    {
+        if (std::all_of(phraseIds.begin(), phraseIds.end(), [&, id = id](const auto& phrase) { return matchesPhrase(id, phrase); }))
+            results.push_back({ id, score });
+    }
+
+    const auto compare = [](const Result& r1, const Result& r2)
+    {
+        return r1.score != r2.score ? r1.score > r2.score : r1.id > r2.id;
+    };
+
+    if (results.size() > limit)
+    {
+        std::partial_sort(results.begin(), results.begin() + static_cast<std::ptrdiff_t>(limit), results.end(), compare);
+        results.resize(limit);
+    }
+    else
+    {
+        std::sort(results.begin(), results.end(), compare);
+    }
+
+    return results;
+}
+
+void SearchIndex::rebuild(dbo::Session& session)
+{
+    dbo::Transaction t { session };
+    auto posts = session.find<Post>().resultList();
+
+    std::unique_lock<std::shared_mutex> lock { _mutex };
+
+    reset();
+
+    for (const auto& post : posts)
+    {
+        auto document = makeDocument(post->visibility == Post::Visibility::Published, tokenize(post->title.toUTF8()), tokenize(post->intro.toUTF8()), tokenize(post->content.toUTF8()));
+        insert(post.id(), std::move(document));
+    }
+
+    // Written in one go rather than a record per post.
+    persist(lock);
+}
+
+uint32_t SearchIndex::termId(const std::string& term)
+{
+    auto it = _termIds.find(term);
+    if (it != _termIds.end())
+        return it->second;
+
+    uint32_t id;
+
+    if (!_freeTermIds.empty())
+    {
+        id = _freeTermIds.back();
+        _freeTermIds.pop_back();
+        _terms[id] = term;
+    }
+    else
+    {
+        id = static_cast<uint32_t>(_terms.size());
+        _terms.push_back(term);
+        _postings.emplace_back();
+    }
+
+    _termIds.emplace(term, id);
+    return id;
+}
+
+SearchIndex::Document SearchIndex::makeDocument(bool published, const std::vector<std::string>& titleTerms, const std::vector<std::string>& introTerms, const std::vector<std::string>& contentTerms)
+{
+    Document document;
+    document.published = published;
+    document.titleLength = static_cast<uint32_t>(titleTerms.size());
+    document.introLength = static_cast<uint32_t>(introTerms.size());
+    document.terms.reserve(titleTerms.size() + introTerms.size() + contentTerms.size());
+
+    for (const auto* terms : { &titleTerms, &introTerms, &contentTerms })
+    {
+        for (const auto& term : *terms)
+            document.terms.push_back(termId(term));
+    }
+
+    return document;
+}
+
+void SearchIndex::insert(long long id, Document document)
+{
+    std::unordered_map<uint32_t, std::vector<uint32_t>> positions;
+
+    for (uint32_t position = 0u; position < document.terms.size(); ++position)
+        positions[document.terms[position]].push_back(position);
+
+    for (auto& [term, termPositions] : positions)
+    {
+        auto& postings = _postings[term];
+
+        // Posting lists are sorted by document id. Posts are usually indexed in order, so it's mostly an append.
+        auto it = std::lower_bound(postings.begin(), postings.end(), id, [](const Posting& p, long long id) { return p.id < id; });
+        postings.insert(it, Posting { id, std::move(termPositions) });
+    }
+
+    _totalLength += document.terms.size();
+    _documents[id] = std::move(document);
+}
+
+void SearchIndex::erase(long long id)
+{
+    auto documentIt = _documents.find(id);
+    if (documentIt == _documents.end())
+        return;
+
+    auto terms = documentIt->second.terms;
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    for (auto term : terms)
+    {
+        auto& postings = _postings[term];
+        auto it = std::lower_bound(postings.begin(), postings.end(), id, [](const Posting& p, long long id) { return p.id < id; });
+
+        if (it != postings.end() && it->id == id)
+            postings.erase(it);
+
+        // Term is no longer used by any document, drop it from the vocabulary.
+        if (postings.empty())
+        {
+            _termIds.erase(_terms[term]);
+            std::string().swap(_terms[term]);
+            std::vector<Posting>().swap(postings);
+            _freeTermIds.push_back(term);
+        }
+    }
+
+    _totalLength -= documentIt->second.terms.size();
+    _documents.erase(documentIt);
+}
+
+void SearchIndex::persist(std::unique_lock<std::shared_mutex>& lock, const std::string& record)
+{
+    // File lock is taken before the index is unlocked, so records are written in the order they were applied.
+    std::unique_lock<std::mutex> fileLock { _fileMutex };
+
+    const auto live = _documents.size();
+    const auto dead = _fileRecords - std::min(_fileRecords, live);
+
+    if (!record.empty() && dead < std::max(live, g_MinDeadRecords))
+    {
+        lock.unlock();
+        append(record);
+        return;
+    }
+
+    // Index is serialized under its lock, but written without it.
+    auto contents = serialize();
+    lock.unlock();
+
+    write(contents, live);
+}
+
+void SearchIndex::append(const std::string& record)
+{
+    try
+    {
+        auto path = indexPath();
+        auto exists = fs::exists(path);
+
+        if (!exists)
+            fs::create_directories(fs::path(path).parent_path());
+
+        std::ofstream s { path, std::ios::out | std::ios::app };
+
+        if (!exists)
+            s << g_IndexFileHeader << '\n';
+
+        s << record << '\n';
+        s.close();
+
+        if (!s)
+            std::cerr << "Failed to append to search index " << path << std::endl;
+        else
+            ++_fileRecords;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to append to search index: " << e.what() << std::endl;
+    }
+}
+
+void SearchIndex::write(const std::string& contents, std::size_t records)
+{
+    try
+    {
+        auto path = indexPath();
+        auto temporaryPath = path + ".tmp";
+
+        fs::create_directories(fs::path(path).parent_path());
+
+        std::ofstream s { temporaryPath, std::ios::out | std::ios::trunc };
+        s << contents;
+        s.close();
+
+        // Current log is still valid, it's better to keep it than to replace it with a truncated one.
+        if (!s)
+        {
+            std::cerr << "Failed to write search index " << temporaryPath << ", keeping " << path << std::endl;
+            std::error_code error;
+            fs::remove(temporaryPath, error);
+            return;
+        }
+
+        fs::rename(temporaryPath, path);
+        _fileRecords = records;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to write search index: " << e.what() << std::endl;
+    }
+}
+
+std::string SearchIndex::serialize() const
+{
+    std::string contents { g_IndexFileHeader };
+    contents += '\n';
+
+    for (const auto& [id, document] : _documents)
+    {
+        contents += serialize(id, document);
+        contents += '\n';
+    }
+
+    return contents;
+}
+
+std::string SearchIndex::serialize(long long id, const Document& document) const
+{
+    std::string record = "U " + std::to_string(id) + (document.published ? " 1 " : " 0 ") + std::to_string(document.titleLength) + ' ' + std::to_string(document.introLength);
+
+    for (auto term : document.terms)
+    {
+        record += ' ';
+        record += _terms[term];
+    }
+
+    return record;
+}
+
+bool SearchIndex::matchesPhrase(long long id, const std::vector<uint32_t>& phrase) const
+{
+    const auto* first = findPosting(phrase.front(), id);
+    if (first == nullptr)
+        return false;
+
+    std::vector<const Posting*> postings;
+
+    for (auto term : phrase)
+    {
+        const auto* posting = findPosting(term, id);
+        if (posting == nullptr)
+            return false;
+
+        postings.push_back(posting);
+    }
+
+    for (auto start : first->positions)
+    {
+        auto matches = true;
+
+        for (std::size_t i = 1u; i < postings.size() && matches; ++i)
+        {
+            const auto& positions = postings[i]->positions;
+            matches = std::binary_search(positions.begin(), positions.end(), start + static_cast<uint32_t>(i));
+        }
+
+        if (matches)
+            return true;
+    }
+
+    return false;
+}
+
+const SearchIndex::Posting* SearchIndex::findPosting(uint32_t term, long long id) const
+{
+    const auto& postings = _postings[term];
+    auto it = std::lower_bound(postings.begin(), postings.end(), id, [](const Posting& p, long long id) { return p.id < id; });
+
+    return it != postings.end() && it->id == id ? &*it : nullptr;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+
+#include "SearchBackend.h"
+
+/**
+ * In-process, positional inverted index over posts. Index is updated incrementally whenever a post is saved and
+ * persisted to disk as an append-only log, which is compacted when index is loaded and whenever superseded records
+ * outnumber live ones.
+ */
+class SearchIndex
+    : public SearchBackend
+{
+public:
+    SearchIndex() = default;
+
+    /**
+     * Splits text into lower-cased, stemmed terms.
+     */
+    static std::vector<std::string> tokenize(std::string_view text);
+
+    /**
+     * Loads index from disk. If it does not match the database (for example, index file is missing), it is rebuilt
+     * from scratch.
+     */
+    void initialize(dbo::Session& session) override;
+    std::string indexPath() const;
+
+    void update(const dbo::ptr<Post>& post) override;
+    void update(long long id, bool published, std::string_view title, std::string_view intro, std::string_view content);
+    void remove(long long id) override;
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+
+    /**
+     * Ranks documents with BM25. Quoted parts of the query are treated as phrases and have to appear in matching
+     * documents as-is.
+     */
+    [[nodiscard]] std::vector<Result> search(std::string_view query, std::size_t limit, bool includeHidden = false) const;
+    [[nodiscard]] std::vector<Result> search(dbo::Session& session, std::string_view query, std::size_t limit, bool includeHidden) const override;
+
+private:
+    struct Posting
+    {
+        long long id;
+        std::vector<uint32_t> positions;
+    };
+
+    struct Document
+    {
+        bool published = false;
+        uint32_t titleLength = 0u;
+        uint32_t introLength = 0u;
+        std::vector<uint32_t> terms;
+    };
+
+    void loadFile();
+    void rebuild(dbo::Session& session);
+    void reset();
+
+    uint32_t termId(const std::string& term);
+    [[nodiscard]] Document makeDocument(bool published, const std::vector<std::string>& titleTerms, const std::vector<std::string>& introTerms, const std::vector<std::string>& contentTerms);
+    void insert(long long id, Document document);
+    void erase(long long id);
+
+    /**
+     * Appends record to the index file, or rewrites the whole file when record is empty or superseded records
+     * outnumber live ones. Index lock is released as soon as the file lock is held.
+     */
+    void persist(std::unique_lock<std::shared_mutex>& lock, const std::string& record = {});
+    void append(const std::string& record);
+    void write(const std::string& contents, std::size_t records);
+
+    [[nodiscard]] std::string serialize() const;
+    [[nodiscard]] std::string serialize(long long id, const Document& document) const;
+
+    [[nodiscard]] bool matchesPhrase(long long id, const std::vector<uint32_t>& phrase) const;
+    [[nodiscard]] const Posting* findPosting(uint32_t term, long long id) const;
+
+    mutable std::shared_mutex _mutex;
+    // Guards the index file, taken after _mutex when both are needed.
+    mutable std::mutex _fileMutex;
+
+    std::unordered_map<std::string, uint32_t> _termIds;
+    std::vector<std::string> _terms;
+    std::vector<std::vector<Posting>> _postings;
+    // Ids of terms no longer used by any document, reused by termId().
+    std::vector<uint32_t> _freeTermIds;
+    std::unordered_map<long long, Document> _documents;
+    uint64_t _totalLength = 0u;
+
+    // Records in the index file, guarded by _fileMutex.
+    std::size_t _fileRecords = 0u;
+};
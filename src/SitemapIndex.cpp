@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SitemapIndex.h"
+
+#include "models/Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Utils.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    // Limit of URLs in a single sitemap, defined by sitemaps protocol.
+    constexpr auto g_MaxUrlsPerSitemap = 50000u;
+
+    std::string gzip(const std::string& data)
+    {
+        z_stream stream {};
+
+        if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Failed to initialize gzip stream");
+
+        std::string result;
+        result.resize(deflateBound(&stream, data.size()));
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+        stream.avail_out = static_cast<uInt>(result.size());
+
+        auto status = deflate(&stream, Z_FINISH);
+        result.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            throw std::runtime_error("Failed to compress sitemap");
+
+        return result;
+    }
+
+    std::string lastModified(const Wt::WDateTime& published)
+    {
+        return published.isValid() ? published.toString("yyyy-MM-dd").toUTF8() : std::string {};
+    }
+}
+
+SitemapIndex& SitemapIndex::instance()
+{
+    static SitemapIndex i;
+    return i;
+}
+
+void SitemapIndex::initialize(dbo::Session& session, std::string siteUrl)
+{
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+        _siteUrl = std::move(siteUrl);
+    }
+
+    using Row = std::tuple<long long, Wt::WString, Wt::WDateTime>;
+
+    auto rows = session.query<Row>("select id, title, published from post")
+        .where("visibility = ?").bind(Post::Visibility::Published)
+        .resultList();
+
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    _entries.clear();
+
+    for (const auto& [id, title, published] : rows)
+        _entries[id] = { Post::url(id, title), lastModified(published) };
+
+    _firstStalePart = 0u;
+}
+
+void SitemapIndex::update(const dbo::ptr<Post>& post)
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    if (post->visibility == Post::Visibility::Published)
+        _entries[post.id()] = { post->url(), lastModified(post->published) };
+    else if (_entries.erase(post.id()) == 0u)
+        return;
+
+    invalidate(post.id());
+}
+
+void SitemapIndex::remove(long long id)
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    if (_entries.erase(id) > 0u)
+        invalidate(id);
+}
+
+SitemapIndex::Document SitemapIndex::document(std::size_t part)
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    regenerate();
+
+    if (_parts.size() == 1u)
+        return part == 0u ? _parts.front() : nullptr;
+
+    if (part == 0u)
+        return _index;
+
+    return part <= _parts.size() ? _parts[part - 1] : nullptr;
+}
+
+void SitemapIndex::invalidate(long long id)
+{
+    // Parts are consecutive ranges of posts ordered by id, so only the part containing given post and the ones
+    // after it are affected. Newly published posts have the highest ids, so usually only the last part is.
+    auto position = static_cast<std::size_t>(std::distance(_entries.begin(), _entries.lower_bound(id)));
+    _firstStalePart = std::min(_firstStalePart, position / g_MaxUrlsPerSitemap);
+}
+
+void SitemapIndex::regenerate()
+{
+    const auto partsCount = std::max<std::size_t>(1u, (_entries.size() + g_MaxUrlsPerSitemap - 1) / g_MaxUrlsPerSitemap);
+
+    if (_firstStalePart >= partsCount && _parts.size() == partsCount)
+        return;
+
+    _parts.resize(partsCount);
+
+    auto it = std::next(_entries.begin(), std::min(_firstStalePart * g_MaxUrlsPerSitemap, _entries.size()));
+
+    for (auto part = _firstStalePart; part < partsCount; ++part)
+    {
+        std::ostringstream out;
+
+        out << R"(<?xml version="1.0" encoding="UTF-8"?>)" << '\n'
+            << R"(<urlset xmlns="http://www.sitemaps.org/schemas/sitemap/0.9">)" << '\n';
+
+        for (auto count = 0u; it != _entries.end() && count < g_MaxUrlsPerSitemap; ++it, ++count)
+        {
+            out << "<url><loc>" << Wt::Utils::htmlEncode(_siteUrl + it->second.path) << "</loc>";
+
+            if (!it->second.lastModified.empty())
+                out << "<lastmod>" << it->second.lastModified << "</lastmod>";
+
+            out << "</url>\n";
+        }
+
+        out << "</urlset>\n";
+
+        _parts[part] = std::make_shared<const std::string>(gzip(out.str()));
+    }
+
+    if (partsCount > 1u)
+    {
+        std::ostringstream out;
+
+        out << R"(<?xml version="1.0" encoding="UTF-8"?>)" << '\n'
+            << R"(<sitemapindex xmlns="http://www.sitemaps.org/schemas/sitemap/0.9">)" << '\n';
+
+        for (auto part = 1u; part <= partsCount; ++part)
+            out << "<sitemap><loc>" << Wt::Utils::htmlEncode(_siteUrl + "sitemap/" + std::to_string(part) + ".xml") << "</loc></sitemap>\n";
+
+        out << "</sitemapindex>\n";
+
+        _index = std::make_shared<const std::string>(gzip(out.str()));
+    }
+    else
+    {
+        _index = nullptr;
+    }
+
+    _firstStalePart = partsCount;
+}
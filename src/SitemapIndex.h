@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/Session.h>
+#include <Wt/Dbo/ptr.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dbo = Wt::Dbo;
+
+class Post;
+
+/**
+ * Lightweight index of published posts (id, URL, publication date) backing sitemap resources. Index is loaded once
+ * and then updated with single posts, serialized sitemaps are kept gzip compressed and only the parts affected by
+ * a change are regenerated.
+ *
+ * Sitemaps are limited to 50000 URLs each, past that a sitemap index pointing at numbered parts is served instead.
+ */
+class SitemapIndex
+{
+public:
+    using Document = std::shared_ptr<const std::string>;
+
+    static SitemapIndex& instance();
+
+    /**
+     * Loads published posts, URLs are absolute with given site URL (including base path). Has to be called within
+     * a transaction.
+     */
+    void initialize(dbo::Session& session, std::string siteUrl);
+    void update(const dbo::ptr<Post>& post);
+    void remove(long long id);
+
+    /**
+     * Returns gzip compressed document, or null when there is no such part. Part 0 is either the only sitemap
+     * or the sitemap index, parts from 1 up are sitemaps listed in the index.
+     */
+    Document document(std::size_t part);
+
+private:
+    SitemapIndex() = default;
+
+    struct Entry
+    {
+        std::string path;
+        std::string lastModified;
+    };
+
+    void invalidate(long long id);
+    void regenerate();
+
+    std::mutex _mutex;
+    std::map<long long, Entry> _entries;
+
+    std::string _siteUrl;
+    std::vector<Document> _parts;
+    Document _index;
+    std::size_t _firstStalePart = 0u;
+};
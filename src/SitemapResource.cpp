@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SitemapResource.h"
+#include "SitemapIndex.h"
+#include "ApplicationExceptions.h"
+#include "Metrics.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+
+#include <zlib.h>
+
+#include <iostream>
+
+namespace
+{
+    std::string gunzip(const std::string& data)
+    {
+        z_stream stream {};
+
+        if (inflateInit2(&stream, 15 + 16) != Z_OK)
+            throw std::runtime_error("Failed to initialize gzip stream");
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+
+        std::string result;
+        char buffer[16384];
+        int status;
+
+        do
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+
+            status = inflate(&stream, Z_NO_FLUSH);
+
+            if (status != Z_OK && status != Z_STREAM_END)
+                break;
+
+            result.append(buffer, sizeof(buffer) - stream.avail_out);
+        } while (status != Z_STREAM_END);
+
+        inflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            throw std::runtime_error("Failed to decompress sitemap");
+
+        return result;
+    }
+}
+
+SitemapResource::SitemapResource() = default;
+
+SitemapResource::~SitemapResource()
+{
+    beingDeleted();
+}
+
+void SitemapResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Sitemap };
+
+    try
+    {
+        std::size_t part = 0u;
+        const auto& partParameter = request.urlParam("part");
+
+        if (!partParameter.empty())
+        {
+            constexpr std::string_view extension { ".xml" };
+
+            auto number = partParameter.size() > extension.size() && partParameter.compare(partParameter.size() - extension.size(), extension.size(), extension) == 0
+                ? partParameter.substr(0, partParameter.size() - extension.size())
+                : std::string {};
+
+            if (number.empty() || number.size() > 6 || number.find_first_not_of("0123456789") != std::string::npos)
+                throw HTTPStatusException(404);
+
+            part = std::stoul(number);
+
+            if (part == 0u)
+                throw HTTPStatusException(404);
+        }
+
+        auto document = SitemapIndex::instance().document(part);
+
+        if (!document)
+            throw HTTPStatusException(404);
+
+        response.setMimeType("application/xml; charset=utf-8");
+        response.setStatus(200);
+        response.addHeader("Cache-Control", "public, max-age=3600");
+        response.addHeader("Vary", "Accept-Encoding");
+
+        // Sitemaps are kept compressed, virtually every crawler accepts gzip.
+        if (request.headerValue("Accept-Encoding").find("gzip") != std::string::npos)
+        {
+            response.addHeader("Content-Encoding", "gzip");
+            response.setContentLength(document->size());
+            response.out().write(document->data(), document->size());
+        }
+        else
+        {
+            auto data = gunzip(*document);
+            response.setContentLength(data.size());
+            response.out().write(data.data(), data.size());
+        }
+    }
+    catch (const HTTPStatusException& e)
+    {
+        response.setStatus(e.status());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to serve sitemap: " << e.what() << std::endl;
+        response.setStatus(500);
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SnapshotCache.h"
+
+namespace
+{
+    // Upper bound of cached pages, so memory usage does not grow with the number of posts ever requested.
+    constexpr auto g_MaxCachedPages = 1000u;
+}
+
+SnapshotCache& SnapshotCache::instance()
+{
+    static SnapshotCache i;
+    return i;
+}
+
+SnapshotCache::SnapshotCache()
+    : DocumentCache(g_MaxCachedPages)
+{
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SnapshotResource.h"
+#include "EntityTag.h"
+#include "StaticTemplate.h"
+#include "ApplicationExceptions.h"
+#include "ExpressionParser.h"
+#include "ImageExpression.h"
+#include "OutputSink.h"
+#include "Markdown.h"
+#include "RenderPool.h"
+#include "Metrics.h"
+#include "QueryStats.h"
+
+#include "models/BasicSession.h"
+#include "models/SiteConfig.h"
+#include "models/Editor.h"
+#include "models/Post.h"
+#include "models/Tag.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/WString.h>
+#include <Wt/Utils.h>
+
+#include <functional>
+#include <iostream>
+
+namespace
+{
+    constexpr auto g_PostsListPageSize = 10u;
+    // Typical page size, avoids most reallocations while the document is written.
+    constexpr auto g_DocumentReserveSize = 32u * 1024u;
+
+    std::string link(const std::string& href, const std::string& text, const std::string& styleClass = {})
+    {
+        std::string result = "<a href=\"" + Wt::Utils::htmlEncode(href) + "\"";
+
+        if (!styleClass.empty())
+            result += " class=\"" + styleClass + "\"";
+
+        return result + ">" + text + "</a>";
+    }
+
+    /**
+     * Renders expressions for static post pages, links are relative to the base path.
+     */
+    class ExpressionContext
+        : public ExpressionParser::Context
+    {
+    public:
+        ExpressionContext(dbo::Session& session, const std::string& basePath, const std::vector<long long>& imageIds)
+            : _basePath(basePath)
+            , _images(session, imageIds)
+        { }
+
+        std::string image(const std::string& id, const std::string& caption) const override
+        {
+            if (!_images.isImage(id))
+                return {};
+
+            return ImageExpression::render(_basePath + "attachment/" + id, ImageExpression::captionHtml(caption));
+        }
+
+    private:
+        const std::string& _basePath;
+        ImageExpression _images;
+    };
+}
+
+SnapshotResource::SnapshotResource(dbo::SqlConnectionPool& connectionPool, std::string basePath, std::string siteUrl, Page page)
+    : _connectionPool(connectionPool)
+    , _basePath(std::move(basePath))
+    , _siteUrl(std::move(siteUrl))
+    , _page(page)
+{
+}
+
+SnapshotResource::~SnapshotResource()
+{
+    beingDeleted();
+}
+
+void SnapshotResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    Metrics::RequestTimer requestTimer { Metrics::Endpoint::Snapshot };
+    QueryStats::Scope queryStats { _page == Page::Post ? "resource:post" : "resource:posts" };
+
+    try
+    {
+        // Only anonymous page views are served here, everything else belongs to the application.
+        const auto isGet = request.method() == "GET" || request.method() == "HEAD";
+
+        if (!isGet || request.getCookieValue(EditorCookieName) != nullptr || request.getParameter("wtd") != nullptr)
+        {
+            redirectToApplication(request, response);
+            return;
+        }
+
+        std::string key;
+        std::function<SnapshotCache::PagePtr()> render;
+
+        if (_page == Page::Post)
+        {
+            const auto& idParameter = request.urlParam("id");
+
+            if (idParameter.empty() || idParameter.size() > 18 || idParameter.find_first_not_of("0123456789") != std::string::npos)
+                throw HTTPStatusException(404);
+
+            // Keyed by the number, so spellings with leading zeros don't get entries of their own.
+            const auto id = std::stoll(idParameter);
+
+            key = "post/" + std::to_string(id);
+            render = [&, id] { return renderPost(id); };
+        }
+        else
+        {
+            long long before = 0;
+
+            if (auto beforeParameter = request.getParameter("before"))
+            {
+                if (beforeParameter->empty() || beforeParameter->size() > 18 || beforeParameter->find_first_not_of("0123456789") != std::string::npos)
+                    throw HTTPStatusException(404);
+
+                before = std::stoll(*beforeParameter);
+            }
+
+            key = "posts/" + std::to_string(before);
+            render = [&] { return renderPostsList(before); };
+        }
+
+        auto [page, generation] = SnapshotCache::instance().get(key);
+
+        if (!page)
+        {
+            page = render();
+
+            // Post is hidden or doesn't exist, let the application decide what to show.
+            if (!page)
+            {
+                redirectToApplication(request, response);
+                return;
+            }
+
+            SnapshotCache::instance().set(key, page, generation);
+        }
+
+        response.addHeader("ETag", page->etag);
+        response.addHeader("Cache-Control", "public, no-cache");
+
+        if (EntityTag::matches(request.headerValue("If-None-Match"), page->etag))
+        {
+            response.setStatus(304);
+            return;
+        }
+
+        response.setMimeType("text/html; charset=utf-8");
+        response.setStatus(200);
+        response.setContentLength(page->body.size());
+        response.out().write(page->body.data(), page->body.size());
+    }
+    catch (const HTTPStatusException& e)
+    {
+        response.setStatus(e.status());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to serve page snapshot: " << e.what() << std::endl;
+        response.setStatus(500);
+    }
+}
+
+void SnapshotResource::redirectToApplication(const Wt::Http::Request& request, Wt::Http::Response& response) const
+{
+    std::string internalPath = "/";
+
+    if (_page == Page::Post)
+        internalPath += "post/" + request.urlParam("id") + request.pathInfo();
+
+    // Application is deployed at base path, internal path is passed the same way Wt does it for plain HTML sessions.
+    auto location = _basePath + "?_=" + Wt::Utils::urlEncode(internalPath);
+
+    if (auto sessionId = request.getParameter("wtd"))
+        location += "&wtd=" + Wt::Utils::urlEncode(*sessionId);
+
+    // Resource can't hand the request over to the application entry point. 307 makes the client repeat it with the
+    // same method and body, so form posts of plain HTML sessions still reach their session.
+    response.setStatus(307);
+    response.addHeader("Location", location);
+    response.addHeader("Cache-Control", "no-store");
+}
+
+SnapshotCache::PagePtr SnapshotResource::renderPost(long long id) const
+{
+    BasicSession session { _connectionPool };
+    dbo::Transaction t { session };
+
+    auto post = session.find<Post>()
+        .where("id = ?").bind(id)
+        .where("visibility = ?").bind(Post::Visibility::Published)
+        .resultValue();
+
+    if (!post)
+        return nullptr;
+
+    // Content stays in cmark's buffer, expressions are resolved while the document is written.
+    const auto content = Markdown(post->content.toUTF8()).render();
+
+    ExpressionParser expParser;
+    expParser.parse(content.view());
+
+    const ExpressionContext expressionContext { session, _basePath, expParser.imageAttachmentIds() };
+
+    const auto& author = post->author;
+    const auto absoluteUrl = _siteUrl + _basePath + post->url();
+
+    std::string tags;
+    for (const auto& tagName : post->tagNames())
+        tags += link(_basePath + "tag/" + tagName, tagName, "label label-default") + " ";
+
+    StaticTemplate shareButtons { "postView.shareButtons" };
+    shareButtons.bindString("postUrl", Wt::Utils::htmlEncode(absoluteUrl));
+    shareButtons.bindString("encodedPostUrl", Wt::Utils::urlEncode(absoluteUrl));
+
+    StaticTemplate view { "postView.show" };
+    view.bindString("title", Wt::Utils::htmlEncode(post->title.toUTF8()));
+    view.bindString("avatar", "<img class=\"img-responsive\" style=\"max-width: 32px;\" src=\"" + _basePath + "avatar/" + Wt::Utils::urlEncode(author->handle.toUTF8()) + "\"/>");
+    view.bindString("author", link(author->url(_basePath), Wt::Utils::htmlEncode(author->name.toUTF8())));
+    view.bindString("created", (post->published.isValid() ? post->published : post->created).toString().toUTF8());
+    view.bindString("tags", "<div class=\"postTags\">" + tags + "</div>");
+    view.bindString("shareButtons", "<div class=\"pull-right text-right shareButtons\">" + shareButtons.render() + "</div>");
+    view.bindString("intro", Markdown(post->intro.toUTF8()).renderHTML());
+    view.bindWriter("content", [&expParser, &expressionContext](OutputSink& out) { expParser.resolve(expressionContext, out); });
+
+    return renderDocument(post->url(), post->title.toUTF8(), view);
+}
+
+SnapshotCache::PagePtr SnapshotResource::renderPostsList(long long before) const
+{
+    BasicSession session { _connectionPool };
+    dbo::Transaction t { session };
+
+    auto query = session.find<Post>().where("visibility = ?").bind(Post::Visibility::Published);
+
+    if (before > 0)
+        query.where("id < ?").bind(before);
+
+    // One more post is requested to find out whether there is a next page.
+    auto posts = query.orderBy("id desc").limit(g_PostsListPageSize + 1).resultList();
+
+    std::vector<std::string> intros;
+    for (const auto& post : posts)
+    {
+        if (intros.size() == g_PostsListPageSize)
+            break;
+
+        intros.emplace_back(post->intro.toUTF8());
+    }
+
+    intros = RenderPool::instance().renderHTML(intros);
+    auto intro = intros.begin();
+
+    std::string items;
+    OutputSink itemsOut { items };
+    auto count = 0u;
+    long long lastId = 0;
+
+    for (const auto& post : posts)
+    {
+        if (++count > g_PostsListPageSize)
+            break;
+
+        StaticTemplate item { "postView.itemsList.item" };
+        item.bindString("title", Wt::Utils::htmlEncode(post->title.toUTF8()));
+        item.bindString("intro", std::move(*intro++));
+        item.bindString("link", link(_basePath + post->url(), "Read more"));
+
+        item.render(itemsOut);
+        lastId = post.id();
+    }
+
+    StaticTemplate view { "staticPage.postsList" };
+    view.bindString("items", std::move(items));
+
+    if (count > g_PostsListPageSize)
+        view.bindString("olderPosts", link(_basePath + "posts?before=" + std::to_string(lastId), StaticTemplate::message("str.olderPosts")));
+
+    return renderDocument(before > 0 ? "posts?before=" + std::to_string(before) : "posts", {}, view);
+}
+
+SnapshotCache::PagePtr SnapshotResource::renderDocument(const std::string& path, const std::string& title, const StaticTemplate& content) const
+{
+    const auto siteConfig = SiteConfig::current();
+    const auto& siteName = siteConfig->siteName();
+    const auto documentTitle = title.empty() ? siteName : Wt::WString(StaticTemplate::message("str.pageSubtitle")).arg(siteName).arg(title).toUTF8();
+
+    StaticTemplate view { "staticPage" };
+    view.bindString("homeUrl", _basePath);
+    view.bindString("siteName", Wt::Utils::htmlEncode(siteName));
+    view.bindWriter("content", [&content](OutputSink& out) { content.render(out); });
+    view.bindString("footer", Markdown(siteConfig->footer()).renderHTML());
+
+    auto page = std::make_shared<CachedDocument>();
+    page->body.reserve(g_DocumentReserveSize);
+
+    // Whole document is written into the cached page body, without intermediate copies of the content.
+    OutputSink out { page->body };
+
+    out << "<!DOCTYPE html>\n"
+        << "<html lang=\"en\">\n"
+        << "<head>\n"
+        << "<meta charset=\"utf-8\"/>\n"
+        << "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"/>\n"
+        << "<title>" << Wt::Utils::htmlEncode(documentTitle) << "</title>\n"
+        << "<link rel=\"canonical\" href=\"" << Wt::Utils::htmlEncode(_siteUrl + _basePath + path) << "\"/>\n"
+        << "<link rel=\"alternate\" type=\"application/atom+xml\" href=\"" << _basePath << "feed/atom\"/>\n"
+        << "<link rel=\"alternate\" type=\"application/rss+xml\" href=\"" << _basePath << "feed/rss\"/>\n";
+
+    for (const auto& styleSheet : { "resources/themes/bootstrap/3/bootstrap.min.css", "assets/css/highlight/default.min.css", "assets/css/highlight/vs.min.css", "assets/css/cxxblog.css", "assets/font-awesome/css/all.min.css" })
+        out << "<link rel=\"stylesheet\" href=\"" << _basePath << styleSheet << "\"/>\n";
+
+    out << "<script src=\"" << _basePath << "assets/js/highlight.min.js\"></script>\n"
+        << "</head>\n"
+        << "<body>\n";
+
+    view.render(out);
+
+    out << '\n'
+        << "<script>document.querySelectorAll('code[class*=language-], pre[class*=language-]').forEach(function(e) { hljs.highlightBlock(e); e.classList.remove('hljs'); });</script>\n"
+        << "</body>\n"
+        << "</html>\n";
+
+    page->etag = EntityTag::of(page->body);
+
+    return page;
+}
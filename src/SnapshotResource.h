@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/WResource.h>
+#include <Wt/Dbo/SqlConnectionPool.h>
+#include <Wt/Dbo/Session.h>
+
+#include "SnapshotCache.h"
+
+namespace dbo = Wt::Dbo;
+
+class StaticTemplate;
+
+/**
+ * Serves published posts and the posts list as plain, cookie-less HTML, so anonymous readers and crawlers don't
+ * create application sessions. Requests other than GET and HEAD, requests from editors (recognized by a cookie set by
+ * the application after login), Wt session requests and requests for posts that can't be shown are redirected to the
+ * application, keeping their method and body.
+ */
+class SnapshotResource
+    : public Wt::WResource
+{
+public:
+    enum class Page
+    {
+        Post,
+        PostsList
+    };
+
+    static constexpr const char* EditorCookieName = "cxxblog-editor";
+
+    SnapshotResource(dbo::SqlConnectionPool& connectionPool, std::string basePath, std::string siteUrl, Page page);
+    ~SnapshotResource() override;
+
+private:
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+    void redirectToApplication(const Wt::Http::Request& request, Wt::Http::Response& response) const;
+
+    SnapshotCache::PagePtr renderPost(long long id) const;
+    SnapshotCache::PagePtr renderPostsList(long long before) const;
+    SnapshotCache::PagePtr renderDocument(const std::string& path, const std::string& title, const StaticTemplate& content) const;
+
+    dbo::SqlConnectionPool& _connectionPool;
+    const std::string _basePath;
+    const std::string _siteUrl;
+    const Page _page;
+};
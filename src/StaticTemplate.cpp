@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "StaticTemplate.h"
+#include "OutputSink.h"
+
+#include <Wt/WServer.h>
+#include <Wt/WLocale.h>
+#include <Wt/WMessageResourceBundle.h>
+
+#include <memory>
+#include <mutex>
+
+StaticTemplate::StaticTemplate(const std::string& key)
+    : _text { message(key) }
+{
+}
+
+std::string StaticTemplate::message(const std::string& key)
+{
+    // Bundle reads files lazily, so it can't be accessed concurrently.
+    static std::mutex mutex;
+    static std::unique_ptr<Wt::WMessageResourceBundle> bundle;
+
+    std::scoped_lock<std::mutex> lock { mutex };
+
+    if (!bundle)
+    {
+        const auto appRoot = Wt::WServer::instance()->appRoot();
+
+        bundle = std::make_unique<Wt::WMessageResourceBundle>();
+        bundle->use(appRoot + "xml/views");
+        bundle->use(appRoot + "xml/strings");
+    }
+
+    return bundle->resolveKey(Wt::WLocale(), key).str;
+}
+
+void StaticTemplate::bindString(const std::string& name, std::string value)
+{
+    _bindings[name] = std::move(value);
+}
+
+void StaticTemplate::bindWriter(const std::string& name, Writer writer)
+{
+    _bindings[name] = std::move(writer);
+}
+
+std::string StaticTemplate::render() const
+{
+    std::string result;
+    result.reserve(_text.size());
+
+    OutputSink out { result };
+    render(out);
+
+    return result;
+}
+
+void StaticTemplate::render(OutputSink& out) const
+{
+    const std::string_view text { _text };
+    std::string::size_type position = 0;
+
+    while (position < text.size())
+    {
+        auto begin = text.find("${", position);
+        auto end = begin != std::string::npos ? text.find('}', begin) : std::string::npos;
+
+        if (end == std::string::npos)
+        {
+            out << text.substr(position);
+            break;
+        }
+
+        out << text.substr(position, begin - position);
+
+        auto placeholder = text.substr(begin + 2, end - begin - 2);
+        auto name = std::string { placeholder.substr(0, placeholder.find_first_of(" \t\r\n")) };
+
+        if (name.rfind("tr:", 0) == 0)
+        {
+            out << message(name.substr(3));
+        }
+        else if (auto it = _bindings.find(name); it != _bindings.end())
+        {
+            if (auto value = std::get_if<std::string>(&it->second))
+                out << *value;
+            else
+                std::get<Writer>(it->second)(out);
+        }
+
+        position = end + 1;
+    }
+}
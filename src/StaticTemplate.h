@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <variant>
+
+class OutputSink;
+
+/**
+ * Minimal, application independent counterpart of Wt::WTemplate. Templates and strings are read from the same
+ * message bundles (xml/views, xml/strings) the application uses, so pages can be rendered to plain HTML by
+ * stateless resources, without WApplication instance.
+ *
+ * Only ${name} and ${tr:key} placeholders are supported. Placeholder attributes (for ex. class) are ignored, just
+ * like Wt::WTemplate ignores them for bound strings. Unbound placeholders are rendered empty.
+ */
+class StaticTemplate
+{
+public:
+    using Writer = std::function<void(OutputSink& out)>;
+
+    explicit StaticTemplate(const std::string& key);
+
+    static std::string message(const std::string& key);
+
+    void bindString(const std::string& name, std::string value);
+
+    /**
+     * Binds placeholder to a function writing its content while the template is rendered, so large parts
+     * (for ex. post content) go straight to the output instead of being copied into the template.
+     */
+    void bindWriter(const std::string& name, Writer writer);
+
+    [[nodiscard]] std::string render() const;
+    void render(OutputSink& out) const;
+
+private:
+    std::string _text;
+    std::map<std::string, std::variant<std::string, Writer>> _bindings;
+};
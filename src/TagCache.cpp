@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "TagCache.h"
+
+#include "models/Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+
+TagCache& TagCache::instance()
+{
+    static TagCache i;
+    return i;
+}
+
+TagCache::PostIds TagCache::publishedPosts(dbo::Session& session, const std::string& tag)
+{
+    uint64_t generation;
+
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+        if (auto it = _tagPostIdsMap.find(tag); it != _tagPostIdsMap.end())
+            return it->second;
+
+        generation = _generation;
+    }
+
+    auto results = session.query<long long>("select pt.post_id from post_tag pt join tag t on t.id = pt.tag_id join post p on p.id = pt.post_id")
+        .where("t.name = ?").bind(tag)
+        .where("p.visibility = ?").bind(Post::Visibility::Published)
+        .orderBy("pt.post_id desc")
+        .resultList();
+
+    auto ids = std::make_shared<std::vector<long long>>();
+    for (auto id : results)
+        ids->push_back(id);
+
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    // Cache was invalidated while the query was running, results may already be outdated. Unknown tags are not
+    // cached either, since those come straight from the URL.
+    if (generation != _generation || ids->empty())
+        return ids;
+
+    return _tagPostIdsMap.emplace(tag, std::move(ids)).first->second;
+}
+
+void TagCache::invalidate()
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    _tagPostIdsMap.clear();
+    ++_generation;
+}
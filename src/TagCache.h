@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/Session.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dbo = Wt::Dbo;
+
+/**
+ * Caches ids of published posts for each tag, newest first. Cache is shared by all sessions and dropped whenever
+ * a post is saved, since that may change tag membership or visibility of any number of posts.
+ */
+class TagCache
+{
+public:
+    using PostIds = std::shared_ptr<const std::vector<long long>>;
+
+    static TagCache& instance();
+
+    /**
+     * Returns ids of published posts with given tag. On cache miss, ids are read from the database with a single
+     * query, so it has to be called within a transaction.
+     */
+    PostIds publishedPosts(dbo::Session& session, const std::string& tag);
+    void invalidate();
+
+private:
+    TagCache() = default;
+
+    std::mutex _mutex;
+    std::map<std::string, PostIds> _tagPostIdsMap;
+    uint64_t _generation = 0u;
+};
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "TextDelta.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Delta format: "<prefix length>:<suffix length>:<middle>", lengths are in bytes.
+    constexpr char g_Separator = ':';
+
+    inline bool isContinuationByte(std::string_view s, std::string_view::size_type pos)
+    {
+        return pos < s.size() && (static_cast<unsigned char>(s[pos]) & 0xC0u) == 0x80u;
+    }
+
+    std::string_view::size_type parseLength(std::string_view delta, std::string_view::size_type& pos)
+    {
+        auto end = delta.find(g_Separator, pos);
+
+        if (end == std::string_view::npos || end == pos)
+            throw std::runtime_error("Malformed text delta");
+
+        std::string_view::size_type value = 0u;
+
+        for (auto i = pos; i < end; ++i)
+        {
+            if (delta[i] < '0' || delta[i] > '9')
+                throw std::runtime_error("Malformed text delta");
+
+            value = value * 10u + static_cast<std::string_view::size_type>(delta[i] - '0');
+        }
+
+        pos = end + 1;
+        return value;
+    }
+}
+
+std::string TextDelta::encode(std::string_view base, std::string_view target)
+{
+    const auto maxLength = std::min(base.size(), target.size());
+
+    std::string_view::size_type prefix = 0u;
+    while (prefix < maxLength && base[prefix] == target[prefix])
+        ++prefix;
+
+    // Never split multi-byte UTF-8 sequence, middle part has to be a valid string on its own.
+    while (prefix > 0u && (isContinuationByte(base, prefix) || isContinuationByte(target, prefix)))
+        --prefix;
+
+    std::string_view::size_type suffix = 0u;
+    while (suffix < maxLength - prefix && base[base.size() - suffix - 1] == target[target.size() - suffix - 1])
+        ++suffix;
+
+    while (suffix > 0u && (isContinuationByte(base, base.size() - suffix) || isContinuationByte(target, target.size() - suffix)))
+        --suffix;
+
+    auto middle = target.substr(prefix, target.size() - prefix - suffix);
+
+    std::string delta;
+    delta.reserve(middle.size() + 24u);
+
+    delta += std::to_string(prefix);
+    delta += g_Separator;
+    delta += std::to_string(suffix);
+    delta += g_Separator;
+    delta += middle;
+
+    return delta;
+}
+
+std::string TextDelta::apply(std::string_view base, std::string_view delta)
+{
+    std::string_view::size_type pos = 0u;
+
+    auto prefix = parseLength(delta, pos);
+    auto suffix = parseLength(delta, pos);
+
+    if (prefix > base.size() || suffix > base.size() - prefix)
+        throw std::runtime_error("Text delta does not match its base");
+
+    auto middle = delta.substr(pos);
+
+    std::string result;
+    result.reserve(prefix + middle.size() + suffix);
+
+    result += base.substr(0u, prefix);
+    result += middle;
+    result += base.substr(base.size() - suffix);
+
+    return result;
+}
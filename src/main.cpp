@@ -17,19 +17,12 @@
  */
 
 #include <Wt/WServer.h>
-#include <Wt/Dbo/SqlConnectionPool.h>
 
-#include <Wt/Http/Request.h>
-#include <Wt/Http/Response.h>
-
-#include "Application.h"
-
-#include "AvatarResource.h"
-#include "AttachmentCache.h"
-#include "AttachmentResource.h"
-#include "AttachmentIconResource.h"
+#include "BlogServer.h"
 #include "Markdown.h"
 
+#include <iostream>
+
 int main(int argc, char **argv)
 {
     Markdown::init();
@@ -37,67 +30,11 @@ int main(int argc, char **argv)
     try
     {
         Wt::WServer server(argc, argv, WTHTTP_CONFIGURATION);
-
-        std::string loginPath;
-        if (server.readConfigurationProperty("loginPath", loginPath))
-        {
-            if (loginPath.size() < 5)
-                throw std::runtime_error("Login path is too short");
-
-            for (const auto c : loginPath)
-            {
-                if (c == '-')
-                    continue;
-
-                if (std::isalnum(c))
-                    continue;
-
-                throw std::runtime_error("Login path contains forbidden characters. It can only contain alphanumeric characters and must have at least 5 characters.");
-            }
-        }
-
-        DBConnectionInfo dbConnectionInfo;
-        if (!server.readConfigurationProperty("dbType", dbConnectionInfo.dbType) || dbConnectionInfo.dbType.empty())
-            dbConnectionInfo.dbType = "sqlite";
-
-        if (dbConnectionInfo.dbType == "sqlite")
-        {
-            dbConnectionInfo.dbName = server.appRoot() + "database.sq3";
-        }
-        else
-        {
-            server.readConfigurationProperty("dbName", dbConnectionInfo.dbName);
-            server.readConfigurationProperty("dbUsername", dbConnectionInfo.dbUsername);
-            server.readConfigurationProperty("dbPassword", dbConnectionInfo.dbPassword);
-            server.readConfigurationProperty("dbHost", dbConnectionInfo.dbHost);
-            server.readConfigurationProperty("dbPort", dbConnectionInfo.dbPort);
-        }
-
-        AttachmentCache::instance().invalidate();
-        Session::initAuthServices();
-
-        auto dbConnectionPool = Session::createConnectionPool(std::move(dbConnectionInfo));
-        const std::string basePath = "/";
-
-        // Register avatar stateless resource.
-        AvatarResource avatarResource { *dbConnectionPool };
-        server.addResource(&avatarResource, basePath + "avatar/${handle}");
-
-        // Register attachment preview stateless resource.
-        AttachmentIconResource attachmentPreviewResource { *dbConnectionPool };
-        server.addResource(&attachmentPreviewResource, basePath + "attachment-icon/${id}");
-
-        // Register attachment stateless resource.
-        AttachmentResource attachmentResource { *dbConnectionPool };
-        server.addResource(&attachmentResource, basePath + "attachment/${id}");
-
-        // Register entry point for the application.
-        server.addEntryPoint(Wt::EntryPointType::Application, [&](const Wt::WEnvironment& env)
-        {
-            return std::make_unique<Application>(basePath, env, *dbConnectionPool);
-        });
+        BlogServer blogServer { server };
 
         server.run();
+        blogServer.logStatistics();
+
         return 0;
     }
     catch (const Wt::WServer::Exception& e)
@@ -26,6 +26,7 @@
 #include "Post.h"
 #include "PostDraft.h"
 #include "Attachment.h"
+#include "Tag.h"
 
 #include "ConfigStore.h"
 
@@ -50,6 +51,7 @@ BasicSession::BasicSession(dbo::SqlConnectionPool& dbConnectionPool)
     mapClass<Post>("post");
     mapClass<PostDraft>("post_draft");
     mapClass<Attachment>("attachment");
+    mapClass<Tag>("tag");
 
     mapClass<ConfigStore>("config_store");
 }
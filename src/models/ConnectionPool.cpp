@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "ConnectionPool.h"
+
+#include <Wt/Dbo/Exception.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const auto g_SqliteMmapSize = 256ll * 1024 * 1024;
+    // Negative value is interpreted by SQLite as size in KiB.
+    const auto g_SqliteCacheSizeKiB = 16 * 1024;
+    const auto g_SqliteBusyTimeoutMs = 5000;
+}
+
+ConnectionPool::ConnectionPool(std::unique_ptr<dbo::SqlConnection> prototype, Options options)
+    : _options(std::move(options))
+    , _prototype(std::move(prototype))
+{
+    if (_options.size == 0u)
+        throw std::invalid_argument("Connection pool size has to be greater than 0");
+
+    _metrics.size = _options.size;
+
+    for (auto i = 0u; i < std::min(_options.warmUp, _options.size); ++i)
+    {
+        _freeConnections.emplace_back(createConnection());
+        ++_metrics.open;
+    }
+}
+
+ConnectionPool::~ConnectionPool() = default;
+
+std::unique_ptr<dbo::SqlConnection> ConnectionPool::getConnection()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + _options.acquireTimeout;
+
+    std::unique_lock<std::mutex> lock { _mutex };
+
+    while (_freeConnections.empty() && _metrics.open >= _options.size)
+    {
+        if (_connectionAvailable.wait_until(lock, deadline) == std::cv_status::timeout && _freeConnections.empty() && _metrics.open >= _options.size)
+        {
+            ++_metrics.timeouts;
+            throw TimeoutException("Timed out waiting for a database connection");
+        }
+    }
+
+    std::unique_ptr<dbo::SqlConnection> connection;
+
+    if (!_freeConnections.empty())
+    {
+        connection = std::move(_freeConnections.back());
+        _freeConnections.pop_back();
+    }
+    else
+    {
+        // Reserve the slot and open the connection without holding the lock.
+        ++_metrics.open;
+        lock.unlock();
+
+        try
+        {
+            connection = createConnection();
+        }
+        catch (...)
+        {
+            lock.lock();
+            --_metrics.open;
+            _connectionAvailable.notify_one();
+            throw;
+        }
+
+        lock.lock();
+    }
+
+    const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    ++_metrics.acquisitions;
+    ++_metrics.inUse;
+    _metrics.peakInUse = std::max(_metrics.peakInUse, _metrics.inUse);
+    _metrics.totalWait += wait;
+    _metrics.maxWait = std::max(_metrics.maxWait, wait);
+
+    return connection;
+}
+
+void ConnectionPool::returnConnection(std::unique_ptr<dbo::SqlConnection> connection)
+{
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+
+        --_metrics.inUse;
+        _freeConnections.emplace_back(std::move(connection));
+    }
+
+    _connectionAvailable.notify_one();
+}
+
+void ConnectionPool::prepareForDropTables() const
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+
+    for (const auto& connection : _freeConnections)
+        connection->prepareForDropTables();
+}
+
+ConnectionPool::Metrics ConnectionPool::metrics() const
+{
+    std::scoped_lock<std::mutex> lock { _mutex };
+    return _metrics;
+}
+
+std::vector<std::string> ConnectionPool::sqliteProfile()
+{
+    return {
+        "pragma journal_mode = wal",
+        "pragma synchronous = normal",
+        "pragma mmap_size = " + std::to_string(g_SqliteMmapSize),
+        "pragma cache_size = -" + std::to_string(g_SqliteCacheSizeKiB),
+        "pragma busy_timeout = " + std::to_string(g_SqliteBusyTimeoutMs)
+    };
+}
+
+std::unique_ptr<dbo::SqlConnection> ConnectionPool::createConnection() const
+{
+    auto connection = _prototype->clone();
+
+    for (const auto& statement : _options.setupStatements)
+        connection->executeSql(statement);
+
+    if (_options.readOnly)
+        connection->executeSql("pragma query_only = on");
+
+    return connection;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/Exception.h>
+#include <Wt/Dbo/SqlConnection.h>
+#include <Wt/Dbo/SqlConnectionPool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dbo = Wt::Dbo;
+
+/**
+ * Connection pool with configurable size, acquire timeout and warm-up, which keeps track of connection wait
+ * times and utilisation. Connections are opened lazily (past warm-up) by cloning the prototype connection.
+ */
+class ConnectionPool
+    : public dbo::SqlConnectionPool
+{
+public:
+    struct Options
+    {
+        std::size_t size = 10u;
+        std::chrono::milliseconds acquireTimeout { 10000 };
+        // Number of connections opened up front.
+        std::size_t warmUp = 1u;
+        // Statements executed on every new connection, e.g. backend specific pragmas.
+        std::vector<std::string> setupStatements;
+        // Connections are switched to read-only mode (SQLite only).
+        bool readOnly = false;
+    };
+
+    struct Metrics
+    {
+        std::size_t size = 0u;
+        std::size_t open = 0u;
+        std::size_t inUse = 0u;
+        std::size_t peakInUse = 0u;
+        uint64_t acquisitions = 0u;
+        uint64_t timeouts = 0u;
+        std::chrono::microseconds totalWait { 0 };
+        std::chrono::microseconds maxWait { 0 };
+    };
+
+    /**
+     * Thrown by getConnection() when no connection got free within acquire timeout. Unlike other failures, it
+     * means the database is busy rather than unreachable.
+     */
+    class TimeoutException
+        : public dbo::Exception
+    {
+    public:
+        using dbo::Exception::Exception;
+    };
+
+    ConnectionPool(std::unique_ptr<dbo::SqlConnection> prototype, Options options);
+    ~ConnectionPool() override;
+
+    std::unique_ptr<dbo::SqlConnection> getConnection() override;
+    void returnConnection(std::unique_ptr<dbo::SqlConnection> connection) override;
+    void prepareForDropTables() const override;
+
+    Metrics metrics() const;
+
+    /**
+     * Production profile for SQLite connections: WAL journal, so readers are not blocked by the writer, relaxed
+     * syncing (safe in WAL mode), memory mapped I/O, larger page cache and waiting on locks instead of failing.
+     */
+    static std::vector<std::string> sqliteProfile();
+
+private:
+    std::unique_ptr<dbo::SqlConnection> createConnection() const;
+
+    const Options _options;
+
+    // Prototype is never handed out, so it can be cloned while other connections are in use.
+    std::unique_ptr<dbo::SqlConnection> _prototype;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _connectionAvailable;
+    std::vector<std::unique_ptr<dbo::SqlConnection>> _freeConnections;
+    Metrics _metrics;
+};
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "InstrumentedConnection.h"
+#include "QueryLog.h"
+#include "QueryStats.h"
+
+#include <chrono>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    void reportStatement(const std::string& sql, Clock::duration elapsed, uint64_t rows)
+    {
+        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+
+        QueryLog::instance().record(sql, duration, rows);
+        QueryStats::record(sql, duration, rows);
+    }
+
+    /**
+     * Accumulates time of execute() and all nextRow() calls, statement is reported once its results are
+     * exhausted, it is reset for the next use or destroyed.
+     */
+    class InstrumentedStatement
+        : public dbo::SqlStatement
+    {
+    public:
+        explicit InstrumentedStatement(std::unique_ptr<dbo::SqlStatement> statement)
+            : _statement(std::move(statement))
+        {
+        }
+
+        ~InstrumentedStatement() override
+        {
+            report();
+        }
+
+        void reset() override
+        {
+            report();
+            _statement->reset();
+        }
+
+        void bind(int column, const std::string& value) override { _statement->bind(column, value); }
+        void bind(int column, short value) override { _statement->bind(column, value); }
+        void bind(int column, int value) override { _statement->bind(column, value); }
+        void bind(int column, long long value) override { _statement->bind(column, value); }
+        void bind(int column, float value) override { _statement->bind(column, value); }
+        void bind(int column, double value) override { _statement->bind(column, value); }
+        void bind(int column, const std::chrono::system_clock::time_point& value, dbo::SqlDateTimeType type) override { _statement->bind(column, value, type); }
+        void bind(int column, const std::chrono::duration<int, std::milli>& value) override { _statement->bind(column, value); }
+        void bind(int column, const std::vector<unsigned char>& value) override { _statement->bind(column, value); }
+        void bindNull(int column) override { _statement->bindNull(column); }
+
+        void execute() override
+        {
+            report();
+
+            _pending = true;
+            measure([this] { _statement->execute(); });
+        }
+
+        long long insertedId() override { return _statement->insertedId(); }
+        int affectedRowCount() override { return _statement->affectedRowCount(); }
+
+        bool nextRow() override
+        {
+            bool hasRow = false;
+            measure([this, &hasRow] { hasRow = _statement->nextRow(); });
+
+            if (hasRow)
+                ++_rows;
+            else
+                report();
+
+            return hasRow;
+        }
+
+        int columnCount() const override { return _statement->columnCount(); }
+
+        bool getResult(int column, std::string* value, int size) override { return _statement->getResult(column, value, size); }
+        bool getResult(int column, short* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, int* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, long long* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, float* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, double* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, std::chrono::system_clock::time_point* value, dbo::SqlDateTimeType type) override { return _statement->getResult(column, value, type); }
+        bool getResult(int column, std::chrono::duration<int, std::milli>* value) override { return _statement->getResult(column, value); }
+        bool getResult(int column, std::vector<unsigned char>* value, int size) override { return _statement->getResult(column, value, size); }
+
+        std::string sql() const override { return _statement->sql(); }
+
+    private:
+        template<typename Fn>
+        void measure(Fn&& fn)
+        {
+            const auto start = Clock::now();
+
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                _elapsed += Clock::now() - start;
+                report();
+                throw;
+            }
+
+            _elapsed += Clock::now() - start;
+        }
+
+        void report()
+        {
+            if (!_pending)
+                return;
+
+            reportStatement(_statement->sql(), _elapsed, _rows);
+
+            _pending = false;
+            _elapsed = Clock::duration::zero();
+            _rows = 0u;
+        }
+
+        std::unique_ptr<dbo::SqlStatement> _statement;
+
+        bool _pending = false;
+        Clock::duration _elapsed = Clock::duration::zero();
+        uint64_t _rows = 0u;
+    };
+}
+
+InstrumentedConnection::InstrumentedConnection(std::unique_ptr<dbo::SqlConnection> connection)
+    : _connection(std::move(connection))
+{
+}
+
+InstrumentedConnection::~InstrumentedConnection()
+{
+    // Cached statements belong to the wrapped connection, they have to go first.
+    clearStatementCache();
+}
+
+std::unique_ptr<dbo::SqlConnection> InstrumentedConnection::clone() const
+{
+    return std::make_unique<InstrumentedConnection>(_connection->clone());
+}
+
+void InstrumentedConnection::executeSql(const std::string& sql)
+{
+    const auto start = Clock::now();
+    _connection->executeSql(sql);
+
+    reportStatement(sql, Clock::now() - start, 0u);
+}
+
+void InstrumentedConnection::startTransaction()
+{
+    _connection->startTransaction();
+}
+
+void InstrumentedConnection::commitTransaction()
+{
+    const auto start = Clock::now();
+    _connection->commitTransaction();
+
+    // Commit is where SQLite syncs the journal, so it is worth tracking on its own.
+    reportStatement("commit", Clock::now() - start, 0u);
+}
+
+void InstrumentedConnection::rollbackTransaction()
+{
+    _connection->rollbackTransaction();
+}
+
+std::unique_ptr<dbo::SqlStatement> InstrumentedConnection::prepareStatement(const std::string& sql)
+{
+    return std::make_unique<InstrumentedStatement>(_connection->prepareStatement(sql));
+}
+
+std::string InstrumentedConnection::autoincrementSql() const
+{
+    return _connection->autoincrementSql();
+}
+
+std::vector<std::string> InstrumentedConnection::autoincrementCreateSequenceSql(const std::string& table, const std::string& id) const
+{
+    return _connection->autoincrementCreateSequenceSql(table, id);
+}
+
+std::vector<std::string> InstrumentedConnection::autoincrementDropSequenceSql(const std::string& table, const std::string& id) const
+{
+    return _connection->autoincrementDropSequenceSql(table, id);
+}
+
+std::string InstrumentedConnection::autoincrementType() const
+{
+    return _connection->autoincrementType();
+}
+
+std::string InstrumentedConnection::autoincrementInsertInfix(const std::string& id) const
+{
+    return _connection->autoincrementInsertInfix(id);
+}
+
+std::string InstrumentedConnection::autoincrementInsertSuffix(const std::string& id) const
+{
+    return _connection->autoincrementInsertSuffix(id);
+}
+
+const char* InstrumentedConnection::dateTimeType(dbo::SqlDateTimeType type) const
+{
+    return _connection->dateTimeType(type);
+}
+
+const char* InstrumentedConnection::blobType() const
+{
+    return _connection->blobType();
+}
+
+std::string InstrumentedConnection::textType(int size) const
+{
+    return _connection->textType(size);
+}
+
+std::string InstrumentedConnection::longLongType() const
+{
+    return _connection->longLongType();
+}
+
+const char* InstrumentedConnection::booleanType() const
+{
+    return _connection->booleanType();
+}
+
+bool InstrumentedConnection::supportAlterTable() const
+{
+    return _connection->supportAlterTable();
+}
+
+bool InstrumentedConnection::supportDeferrableFKConstraint() const
+{
+    return _connection->supportDeferrableFKConstraint();
+}
+
+const char* InstrumentedConnection::alterTableConcatenator() const
+{
+    return _connection->alterTableConcatenator();
+}
+
+bool InstrumentedConnection::requireSubqueryAlias() const
+{
+    return _connection->requireSubqueryAlias();
+}
+
+dbo::LimitQuery InstrumentedConnection::limitQueryMethod() const
+{
+    return _connection->limitQueryMethod();
+}
+
+bool InstrumentedConnection::supportUpdateCascade() const
+{
+    return _connection->supportUpdateCascade();
+}
+
+void InstrumentedConnection::prepareForDropTables()
+{
+    _connection->prepareForDropTables();
+}
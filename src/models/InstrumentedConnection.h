@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/SqlConnection.h>
+#include <Wt/Dbo/SqlStatement.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dbo = Wt::Dbo;
+
+/**
+ * Connection decorator which measures time spent executing statements and fetching their rows, and reports it to
+ * QueryLog and QueryStats. Dialect is taken from the wrapped connection, so it can wrap any backend. Statements
+ * are prepared and cached by Wt::Dbo on this connection, so the wrapped one never sees them twice.
+ */
+class InstrumentedConnection
+    : public dbo::SqlConnection
+{
+public:
+    explicit InstrumentedConnection(std::unique_ptr<dbo::SqlConnection> connection);
+    ~InstrumentedConnection() override;
+
+    dbo::SqlConnection& wrapped() const { return *_connection; }
+
+    std::unique_ptr<dbo::SqlConnection> clone() const override;
+
+    void executeSql(const std::string& sql) override;
+    void startTransaction() override;
+    void commitTransaction() override;
+    void rollbackTransaction() override;
+
+    std::unique_ptr<dbo::SqlStatement> prepareStatement(const std::string& sql) override;
+
+    std::string autoincrementSql() const override;
+    std::vector<std::string> autoincrementCreateSequenceSql(const std::string& table, const std::string& id) const override;
+    std::vector<std::string> autoincrementDropSequenceSql(const std::string& table, const std::string& id) const override;
+    std::string autoincrementType() const override;
+    std::string autoincrementInsertInfix(const std::string& id) const override;
+    std::string autoincrementInsertSuffix(const std::string& id) const override;
+    const char* dateTimeType(dbo::SqlDateTimeType type) const override;
+    const char* blobType() const override;
+    std::string textType(int size) const override;
+    std::string longLongType() const override;
+    const char* booleanType() const override;
+    bool supportAlterTable() const override;
+    bool supportDeferrableFKConstraint() const override;
+    const char* alterTableConcatenator() const override;
+    bool requireSubqueryAlias() const override;
+    dbo::LimitQuery limitQueryMethod() const override;
+    bool supportUpdateCascade() const override;
+    void prepareForDropTables() override;
+
+private:
+    std::unique_ptr<dbo::SqlConnection> _connection;
+};
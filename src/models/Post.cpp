@@ -19,14 +19,20 @@
 #include "Post.h"
 #include "PostDraft.h"
 #include "Editor.h"
+#include "Tag.h"
 
 #include <Wt/Dbo/Dbo.h>
 #include <algorithm>
+#include <cassert>
+#include <limits>
 #include <locale>
 
 namespace
 {
+    // Number of drafts shown to the editor.
     const auto g_MaxPostDraftsCount = 3u;
+    // Number of drafts kept in the database. Drafts are mostly stored as deltas, so history can be much longer.
+    const auto g_MaxRetainedPostDraftsCount = 50u;
 }
 
 DBO_INSTANTIATE_TEMPLATES(Post)
@@ -34,38 +40,122 @@ DBO_INSTANTIATE_TEMPLATES(Post)
 std::vector<dbo::ptr<PostDraft>> Post::latestDrafts() const
 {
     std::vector<dbo::ptr<PostDraft>> latestDrafts;
+    latestDrafts.reserve(g_MaxPostDraftsCount);
 
-    auto postDrafts = drafts.find().orderBy("id desc").resultList();
-    auto it = postDrafts.begin();
-    auto n = 0u;
+    for (auto& draft : drafts.find().orderBy("id desc").limit(g_MaxPostDraftsCount).resultList())
+        latestDrafts.emplace_back(std::move(draft));
 
-    // Unfortunately, std::advance does not work with Wt iterator, for some reason. Advance it manually.
-    while (++n <= g_MaxPostDraftsCount && it != postDrafts.end())
-    {
-        latestDrafts.emplace_back(std::move(*it));
-        ++it;
-    }
+    return latestDrafts;
+}
 
-    // Remove everything past the maximal draft count limit.
-    while (it != postDrafts.end())
-    {
-        auto draft = *it;
-        ++it;
-        draft.remove();
-    }
+dbo::ptr<PostDraft> Post::latestDraft() const
+{
+    return drafts.find().orderBy("id desc").limit(1).resultValue();
+}
 
-    return latestDrafts;
+void Post::pruneDrafts() const
+{
+    auto s = session();
+    assert(s != nullptr);
+
+    // Make sure freshly added drafts are already in the database, otherwise they would not be taken
+    // into account by queries below.
+    s->flush();
+
+    std::vector<dbo::ptr<PostDraft>> retained;
+    retained.reserve(g_MaxRetainedPostDraftsCount);
+
+    for (auto& draft : drafts.find().orderBy("id desc").limit(g_MaxRetainedPostDraftsCount).resultList())
+        retained.emplace_back(std::move(draft));
+
+    if (retained.size() < g_MaxRetainedPostDraftsCount)
+        return;
+
+    // Deltas are stored against their base draft, so everything back to the full copies they are built on has to be
+    // kept as well.
+    auto keptId = std::numeric_limits<long long>::max();
+
+    for (const auto& draft : retained)
+        keptId = std::min(keptId, draft->snapshotId());
+
+    s->execute("delete from post_draft where post_id = ? and id < ?")
+        .bind(id())
+        .bind(keptId)
+        .run();
 }
 
 std::string Post::url() const
+{
+    return url(id(), title);
+}
+
+std::string Post::url(long long id, const Wt::WString& title)
 {
     return Wt::WString("post/{1}{2}")
-        .arg(id())
-        .arg(titleAsFriendlyURL())
+        .arg(id)
+        .arg(titleAsFriendlyURL(title))
         .toUTF8();
 }
 
-std::string Post::titleAsFriendlyURL() const
+std::vector<std::string> Post::tagNames() const
+{
+    std::vector<std::string> names;
+
+    for (const auto& tag : tags)
+        names.emplace_back(tag->name.toUTF8());
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::vector<std::string> Post::normalizeTagNames(const std::vector<std::string>& names)
+{
+    std::vector<std::string> normalizedNames;
+
+    for (const auto& name : names)
+    {
+        auto normalized = Tag::normalize(name);
+        if (!normalized.empty())
+            normalizedNames.emplace_back(std::move(normalized));
+    }
+
+    std::sort(normalizedNames.begin(), normalizedNames.end());
+    normalizedNames.erase(std::unique(normalizedNames.begin(), normalizedNames.end()), normalizedNames.end());
+
+    return normalizedNames;
+}
+
+bool Post::setTags(const std::vector<std::string>& names)
+{
+    auto normalizedNames = normalizeTagNames(names);
+
+    if (normalizedNames == tagNames())
+        return false;
+
+    auto s = session();
+    assert(s != nullptr);
+
+    // Post has to be persisted before join table rows referencing it can be written.
+    s->flush();
+    tags.clear();
+
+    for (const auto& name : normalizedNames)
+    {
+        auto tag = s->find<Tag>().where("name = ?").bind(name).resultValue();
+
+        if (!tag)
+        {
+            tag = s->addNew<Tag>();
+            tag.modify()->name = name;
+        }
+
+        tags.insert(tag);
+    }
+
+    return true;
+}
+
+std::string Post::titleAsFriendlyURL(const Wt::WString& title)
 {
     auto titleString { title.toUTF16() };
     std::string result;
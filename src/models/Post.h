@@ -31,6 +31,7 @@
 namespace dbo = Wt::Dbo;
 
 class Editor;
+class Tag;
 
 class Post
     : public dbo::Dbo<Post>
@@ -43,6 +44,7 @@ public:
     };
 
     dbo::collection<dbo::ptr<PostDraft>> drafts;
+    dbo::collection<dbo::ptr<Tag>> tags;
 
     dbo::ptr<Editor> author;
     Wt::WDateTime created;
@@ -58,6 +60,7 @@ public:
     void persist(Action& a)
     {
         dbo::hasMany(a, drafts, dbo::ManyToOne, "post");
+        dbo::hasMany(a, tags, dbo::ManyToMany, "post_tag");
         dbo::belongsTo(a, author, "editor", dbo::NotNull | dbo::OnDeleteCascade | dbo::OnUpdateCascade);
 
         dbo::field(a, created, "created");
@@ -69,10 +72,36 @@ public:
     }
 
     [[nodiscard]] std::vector<dbo::ptr<PostDraft>> latestDrafts() const;
+    [[nodiscard]] dbo::ptr<PostDraft> latestDraft() const;
+
+    /**
+     * Removes all drafts past the retention limit. Must be called within a transaction, after a new draft is added.
+     */
+    void pruneDrafts() const;
+
     [[nodiscard]] std::string url() const;
 
+    /**
+     * Builds post URL without loading the whole post, for ex. from (id, title) query results.
+     */
+    [[nodiscard]] static std::string url(long long id, const Wt::WString& title);
+
+    [[nodiscard]] std::vector<std::string> tagNames() const;
+
+    /**
+     * Normalizes given tag names the way setTags() stores them, sorted and without duplicates, so they can be
+     * compared with tagNames().
+     */
+    [[nodiscard]] static std::vector<std::string> normalizeTagNames(const std::vector<std::string>& names);
+
+    /**
+     * Replaces post tags with given ones, creating missing tags. Must be called within a transaction.
+     * Returns true if tags have changed.
+     */
+    bool setTags(const std::vector<std::string>& names);
+
 private:
-    [[nodiscard]] std::string titleAsFriendlyURL() const;
+    [[nodiscard]] static std::string titleAsFriendlyURL(const Wt::WString& title);
 };
 
 DBO_EXTERN_TEMPLATES(Post)
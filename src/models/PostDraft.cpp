@@ -18,9 +18,27 @@
 
 #include "PostDraft.h"
 #include "Post.h"
+#include "TextDelta.h"
 
 #include <Wt/Dbo/Dbo.h>
 
+#include <iterator>
+#include <string>
+
+namespace
+{
+    // Every n-th revision in a chain is stored as a full copy, which limits how many rows have to be read to
+    // reconstruct a single draft.
+    constexpr auto g_SnapshotInterval = 10u;
+
+    void applyDelta(PostDraft::Revision& revision, const PostDraft& draft)
+    {
+        revision.title = Wt::WString::fromUTF8(TextDelta::apply(revision.title.toUTF8(), draft.title.toUTF8()));
+        revision.intro = Wt::WString::fromUTF8(TextDelta::apply(revision.intro.toUTF8(), draft.intro.toUTF8()));
+        revision.content = Wt::WString::fromUTF8(TextDelta::apply(revision.content.toUTF8(), draft.content.toUTF8()));
+    }
+}
+
 DBO_INSTANTIATE_TEMPLATES(PostDraft)
 
 PostDraft::PostDraft()
@@ -47,8 +65,107 @@ PostDraft::PostDraft(const dbo::ptr<PostDraft>& draft)
     if (draft.get() == nullptr)
         return;
 
+    auto revision = draft->revision();
+
     post = draft->post;
-    title = draft->title;
-    intro = draft->intro;
-    content = draft->content;
+    title = std::move(revision.title);
+    intro = std::move(revision.intro);
+    content = std::move(revision.content);
+}
+
+PostDraft::Revision PostDraft::revision() const
+{
+    Revision revision;
+    resolve(revision);
+    return revision;
+}
+
+void PostDraft::setRevision(const Revision& revision, const dbo::ptr<PostDraft>& previous)
+{
+    storage = Storage::Snapshot;
+    baseId = 0;
+    title = revision.title;
+    intro = revision.intro;
+    content = revision.content;
+
+    if (previous.get() == nullptr)
+        return;
+
+    Revision base;
+    if (previous->resolve(base) + 1u >= g_SnapshotInterval)
+        return;
+
+    auto titleUTF8 = title.toUTF8();
+    auto introUTF8 = intro.toUTF8();
+    auto contentUTF8 = content.toUTF8();
+
+    auto titleDelta = TextDelta::encode(base.title.toUTF8(), titleUTF8);
+    auto introDelta = TextDelta::encode(base.intro.toUTF8(), introUTF8);
+    auto contentDelta = TextDelta::encode(base.content.toUTF8(), contentUTF8);
+
+    // Keep a full copy if delta would not save anything (for example, when whole content was replaced).
+    if (titleDelta.size() + introDelta.size() + contentDelta.size() >= titleUTF8.size() + introUTF8.size() + contentUTF8.size())
+        return;
+
+    storage = Storage::Delta;
+    baseId = previous.id();
+    title = Wt::WString::fromUTF8(titleDelta);
+    intro = Wt::WString::fromUTF8(introDelta);
+    content = Wt::WString::fromUTF8(contentDelta);
+}
+
+long long PostDraft::snapshotId() const
+{
+    if (storage == Storage::Snapshot)
+        return id();
+
+    return bases().back().id();
+}
+
+std::vector<dbo::ptr<PostDraft>> PostDraft::bases() const
+{
+    auto s = session();
+
+    if (s == nullptr)
+        throw std::logic_error("Delta draft is not bound to a session");
+
+    // Deltas are replayed along base links rather than by id, since concurrent saves may encode against the same base.
+    std::vector<dbo::ptr<PostDraft>> bases;
+    auto draftId = id();
+    auto nextId = baseId;
+
+    while (true)
+    {
+        // Bases are always older, which also guards against cycles in corrupted data.
+        if (nextId <= 0 || (draftId > 0 && nextId >= draftId))
+            throw std::runtime_error("Draft " + std::to_string(draftId) + " has invalid base " + std::to_string(nextId));
+
+        auto base = s->load<PostDraft>(nextId);
+        bases.emplace_back(base);
+
+        if (base->storage == Storage::Snapshot)
+            return bases;
+
+        draftId = nextId;
+        nextId = base->baseId;
+    }
+}
+
+std::size_t PostDraft::resolve(Revision& revision) const
+{
+    if (storage == Storage::Snapshot)
+    {
+        revision = { title, intro, content };
+        return 0u;
+    }
+
+    auto chain = bases();
+    const auto& snapshot = chain.back();
+    revision = { snapshot->title, snapshot->intro, snapshot->content };
+
+    for (auto it = std::next(chain.rbegin()); it != chain.rend(); ++it)
+        applyDelta(revision, **it);
+
+    applyDelta(revision, *this);
+    return chain.size();
 }
@@ -24,6 +24,8 @@
 #include <Wt/WString.h>
 #include <Wt/WDateTime.h>
 
+#include <vector>
+
 namespace dbo = Wt::Dbo;
 
 class Post;
@@ -32,13 +34,33 @@ class PostDraft
     : public dbo::Dbo<PostDraft>
 {
 public:
+    enum class Storage
+    {
+        Snapshot,
+        Delta
+    };
+
+    struct Revision
+    {
+        Wt::WString title;
+        Wt::WString intro;
+        Wt::WString content;
+    };
+
     PostDraft();
     explicit PostDraft(dbo::ptr<Post> parent);
     explicit PostDraft(const dbo::ptr<PostDraft>& draft);
 
     dbo::ptr<Post> post;
     Wt::WDateTime created;
+    Storage storage = Storage::Snapshot;
+    // Draft a delta was encoded against, 0 for full copies.
+    long long baseId = 0;
 
+    /**
+     * Depending on storage type, those hold either full values or deltas against the base draft of the same post.
+     * Use revision() to get actual values.
+     */
     Wt::WString title;
     Wt::WString intro;
     Wt::WString content;
@@ -48,11 +70,33 @@ public:
     {
         dbo::belongsTo(a, post, "post", dbo::NotNull | dbo::OnDeleteCascade | dbo::OnUpdateCascade);
         dbo::field(a, created, "created");
+        dbo::field(a, storage, "storage");
+        dbo::field(a, baseId, "base_id");
 
         dbo::field(a, title, "title");
         dbo::field(a, intro, "intro");
         dbo::field(a, content, "content");
     }
+
+    /**
+     * Reconstructs draft values. For delta drafts it has to be called within a transaction.
+     */
+    [[nodiscard]] Revision revision() const;
+
+    /**
+     * Stores given values either as a full copy or as a delta against previous draft of the same post.
+     * Must be called within a transaction.
+     */
+    void setRevision(const Revision& revision, const dbo::ptr<PostDraft>& previous);
+
+    /**
+     * Id of the full copy this draft is reconstructed from. Must be called within a transaction.
+     */
+    [[nodiscard]] long long snapshotId() const;
+
+private:
+    std::vector<dbo::ptr<PostDraft>> bases() const;
+    std::size_t resolve(Revision& revision) const;
 };
 
 DBO_EXTERN_TEMPLATES(PostDraft)
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "ReplicaConnectionPool.h"
+#include "ConnectionPool.h"
+#include "Metrics.h"
+
+#include <iostream>
+
+ReplicaConnectionPool::ReplicaConnectionPool(ConnectionPool& replica, ConnectionPool& primary, std::chrono::seconds retryDelay)
+    : _replica(replica)
+    , _primary(primary)
+    , _retryDelay(retryDelay)
+{
+}
+
+ReplicaConnectionPool::~ReplicaConnectionPool() = default;
+
+std::unique_ptr<dbo::SqlConnection> ReplicaConnectionPool::getConnection()
+{
+    bool useReplica = false;
+
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+        useReplica = std::chrono::steady_clock::now() >= _retryAt;
+    }
+
+    if (useReplica)
+    {
+        try
+        {
+            return _replica.getConnection();
+        }
+        catch (const ConnectionPool::TimeoutException&)
+        {
+            // Replica is healthy but busy, moving all reads to the primary would only spread the load spike.
+            throw;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Read replica unavailable, falling back to primary for " << _retryDelay.count() << " s: " << e.what() << std::endl;
+
+            std::scoped_lock<std::mutex> lock { _mutex };
+            _retryAt = std::chrono::steady_clock::now() + _retryDelay;
+        }
+    }
+
+    Metrics::instance().increment(Metrics::Counter::ReplicaFallbacks);
+
+    auto connection = _primary.getConnection();
+
+    std::scoped_lock<std::mutex> lock { _mutex };
+    _primaryConnections.insert(connection.get());
+
+    return connection;
+}
+
+void ReplicaConnectionPool::returnConnection(std::unique_ptr<dbo::SqlConnection> connection)
+{
+    bool fromPrimary = false;
+
+    {
+        std::scoped_lock<std::mutex> lock { _mutex };
+        fromPrimary = _primaryConnections.erase(connection.get()) > 0u;
+    }
+
+    if (fromPrimary)
+        _primary.returnConnection(std::move(connection));
+    else
+        _replica.returnConnection(std::move(connection));
+}
+
+void ReplicaConnectionPool::prepareForDropTables() const
+{
+    _replica.prepareForDropTables();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/SqlConnection.h>
+#include <Wt/Dbo/SqlConnectionPool.h>
+
+#include <chrono>
+#include <mutex>
+#include <set>
+
+namespace dbo = Wt::Dbo;
+
+class ConnectionPool;
+
+/**
+ * Hands out read replica connections, falling back to the primary when a replica connection cannot be obtained.
+ * After a failure the replica is skipped for a while, so requests do not keep waiting on an unreachable host.
+ */
+class ReplicaConnectionPool
+    : public dbo::SqlConnectionPool
+{
+public:
+    ReplicaConnectionPool(ConnectionPool& replica, ConnectionPool& primary, std::chrono::seconds retryDelay);
+    ~ReplicaConnectionPool() override;
+
+    std::unique_ptr<dbo::SqlConnection> getConnection() override;
+    void returnConnection(std::unique_ptr<dbo::SqlConnection> connection) override;
+    void prepareForDropTables() const override;
+
+private:
+    ConnectionPool& _replica;
+    ConnectionPool& _primary;
+    const std::chrono::seconds _retryDelay;
+
+    std::mutex _mutex;
+    std::chrono::steady_clock::time_point _retryAt;
+    // Connections borrowed from the primary, they have to be returned there.
+    std::set<const dbo::SqlConnection*> _primaryConnections;
+};
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SchemaManager.h"
+#include "PostDraft.h"
+
+#include <Wt/Dbo/Dbo.h>
+
+#include <iostream>
+
+namespace
+{
+    // Creates given tables (and indexes on them) out of the schema generated by Wt::Dbo, so classes mapped
+    // after the database was created can be added without writing backend specific SQL by hand.
+    void createTables(dbo::Session& session, const std::vector<std::string>& tables)
+    {
+        const auto sql = session.tableCreationSql();
+        std::string::size_type begin = 0;
+
+        while (begin < sql.size())
+        {
+            auto end = sql.find(";\n", begin);
+            if (end == std::string::npos)
+                end = sql.size();
+
+            auto statement = sql.substr(begin, end - begin);
+            begin = end + 2;
+
+            statement.erase(0, statement.find_first_not_of(" \r\n\t"));
+
+            for (const auto& table : tables)
+            {
+                auto quoted = "\"" + table + "\"";
+
+                if (statement.rfind("create table " + quoted, 0) == 0 || statement.find(" on " + quoted) != std::string::npos)
+                {
+                    session.execute(statement);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+SchemaManager::SchemaManager(const std::string& basePath, const std::string& siteUrl, dbo::SqlConnectionPool& connectionPool)
+    : _session(basePath, siteUrl, connectionPool, connectionPool)
+{
+}
+
+const std::vector<SchemaManager::Migration>& SchemaManager::migrations()
+{
+    // Migrations are applied in order. New migrations go at the end, with the next version number. Databases
+    // created before schema versioning was introduced are assumed to be at version 1.
+    static const std::vector<Migration> migrations {
+        {
+            1, "Initial schema",
+            [](Session&) { },
+            { "create unique index editor_handle_index on editor(handle)" }
+        },
+        {
+            2, "Store drafts as deltas",
+            [](Session& session)
+            {
+                // Existing drafts are full copies, hence the default value.
+                session.execute("alter table post_draft add column storage integer not null default 0");
+            },
+            {}
+        },
+        {
+            3, "Post tags",
+            [](Session& session)
+            {
+                createTables(session, { "tag", "post_tag" });
+            },
+            { "create unique index tag_name_index on tag(name)" }
+        },
+        {
+            4, "Link delta drafts to their base draft",
+            [](Session& session)
+            {
+                session.execute("alter table post_draft add column base_id bigint not null default 0");
+
+                // Deltas written so far were encoded against the previous draft of the same post. The derived table
+                // keeps MySQL from rejecting a subquery on the table being updated.
+                session.execute("update post_draft set base_id = "
+                                "(select max(previous.id) from (select id, post_id from post_draft) previous "
+                                "where previous.post_id = post_draft.post_id and previous.id < post_draft.id) "
+                                "where storage = ?")
+                    .bind(PostDraft::Storage::Delta)
+                    .run();
+            },
+            {}
+        },
+    };
+
+    return migrations;
+}
+
+void SchemaManager::update()
+{
+    {
+        dbo::Transaction t { _session };
+        _session.execute("create table if not exists schema_version (version integer not null primary key, description varchar(255) not null)");
+        t.commit();
+    }
+
+    auto version = currentVersion();
+
+    if (version == 0)
+    {
+        if (!databaseExists())
+        {
+            std::cerr << "Creating database schema." << std::endl;
+            createSchema();
+            return;
+        }
+
+        version = 1;
+        std::cerr << "Database has no schema version, assuming version " << version << "." << std::endl;
+
+        dbo::Transaction t { _session };
+        _session.execute("insert into schema_version (version, description) values (?, ?)").bind(version).bind(std::string { "Existing database" });
+        t.commit();
+    }
+
+    for (const auto& migration : migrations())
+    {
+        if (migration.version > version)
+            applyMigration(migration);
+    }
+}
+
+int SchemaManager::currentVersion()
+{
+    dbo::Transaction t { _session };
+    return _session.query<int>("select coalesce(max(version), 0) from schema_version").resultValue();
+}
+
+bool SchemaManager::databaseExists()
+{
+    try
+    {
+        dbo::Transaction t { _session };
+        _session.execute("select count(*) from editor").run();
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+void SchemaManager::createSchema()
+{
+    const auto& latest = migrations().back();
+
+    {
+        dbo::Transaction t { _session };
+
+        _session.createTables();
+        _session.createDefaultContent();
+
+        _session.execute("insert into schema_version (version, description) values (?, ?)").bind(latest.version).bind(latest.description);
+        t.commit();
+    }
+
+    for (const auto& migration : migrations())
+        executeOptionalStatements(migration);
+}
+
+void SchemaManager::applyMigration(const Migration& migration)
+{
+    std::cerr << "Applying schema migration " << migration.version << ": " << migration.description << std::endl;
+
+    {
+        dbo::Transaction t { _session };
+
+        migration.apply(_session);
+        _session.execute("insert into schema_version (version, description) values (?, ?)").bind(migration.version).bind(migration.description);
+        t.commit();
+    }
+
+    executeOptionalStatements(migration);
+}
+
+void SchemaManager::executeOptionalStatements(const Migration& migration)
+{
+    for (const auto& statement : migration.optionalStatements)
+    {
+        try
+        {
+            dbo::Transaction t { _session };
+            _session.execute(statement);
+            t.commit();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Optional schema statement failed (" << statement << "): " << e.what() << std::endl;
+        }
+    }
+}
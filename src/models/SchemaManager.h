@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include "Session.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Creates the database schema, or brings an existing one up to date, once at startup before the server handles
+ * any request. Applied migrations are recorded in schema_version table, each one in its own transaction.
+ */
+class SchemaManager
+{
+public:
+    SchemaManager(const std::string& basePath, const std::string& siteUrl, dbo::SqlConnectionPool& connectionPool);
+
+    /**
+     * Throws when schema can't be brought up to date, server should not be started then.
+     */
+    void update();
+
+private:
+    struct Migration
+    {
+        int version;
+        std::string description;
+        std::function<void(Session&)> apply;
+
+        // Statements executed in separate transactions after the migration, which are allowed to fail. Wt::Dbo
+        // can't express unique constraints and not all backends can index text columns.
+        std::vector<std::string> optionalStatements;
+    };
+
+    static const std::vector<Migration>& migrations();
+
+    int currentVersion();
+    bool databaseExists();
+    void createSchema();
+    void applyMigration(const Migration& migration);
+    void executeOptionalStatements(const Migration& migration);
+
+    Session _session;
+};
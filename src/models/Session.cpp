@@ -26,7 +26,9 @@
 #include <Wt/Auth/Identity.h>
 
 #include <Wt/Dbo/SqlConnectionPool.h>
-#include <Wt/Dbo/FixedSqlConnectionPool.h>
+
+#include "InstrumentedConnection.h"
+#include "ReplicaConnectionPool.h"
 
 #if __has_include(<Wt/Dbo/backend/Sqlite3.h>)
 #include <Wt/Dbo/backend/Sqlite3.h>
@@ -43,152 +45,70 @@
 #define WT_DBO_SUPPORTS_MYSQL
 #endif
 
-#include <atomic>
+#include <iostream>
 #include <numeric>
 
 #include "Post.h"
 #include "AvatarGenerator.h"
-#include "ConfigStore.h"
-
-namespace
-{
-    std::atomic<bool> g_bDatabaseInitialized { false };
-}
 
-Session::Session(const std::string& basePath, Wt::Dbo::SqlConnectionPool& dbConnectionPool)
+Session::Session(const std::string& basePath, const std::string& siteUrl, Wt::Dbo::SqlConnectionPool& dbConnectionPool, Wt::Dbo::SqlConnectionPool& dbReadConnectionPool)
     : BasicSession(dbConnectionPool)
     , _basePath { basePath }
+    , _siteUrl { siteUrl }
     , _users { *this }
+    , _dbReadConnectionPool { dbReadConnectionPool }
+    , _separateReadPool { &dbReadConnectionPool != &dbConnectionPool }
 {
-    auto tryQuery = [this](auto fn)
-    {
-        try
-        {
-            dbo::Transaction t { *this };
-            fn();
-            return true;
-        }
-        catch (const std::exception& e)
-        {
-            std::cerr << "Failed to try query: " << e.what() << std::endl;
-            return false;
-        }
-    };
-
-    if (!g_bDatabaseInitialized)
-    {
-        try
-        {
-            if (tryQuery([=]
-            {
-                execute("select count(*) from editor").run();
-            }))
-            {
-                std::cerr << "Database already exists, running migrations." << std::endl;
-
-                // Here is a place for running migration scripts. Each migration should be a separate
-                // transaction, so it's advised to use tryQuery.
-
-                std::cerr << "Migrations completed." << std::endl;
-            }
-            else
-            {
-                dbo::Transaction t { *this };
-
-                createTables();
-
-                // Create unique index on editor table, since there is no option to create unique constraint in Wt::Dbo.
-                tryQuery([=]
-                {
-                    execute("create unique index editor_handle_index on editor(handle);");
-                });
-
-                // Register a default user account.
-                auto user = _users.registerNew();
-
-                // Set login as identity.
-                user.addIdentity(Wt::Auth::Identity::LoginName, "admin");
-
-                // Activate the first user.
-                user.setStatus(Wt::Auth::AccountStatus::Normal);
-                // Set user password.
-                passwordService().updatePassword(user, "admin");
-
-                // Set up Editor object that adds additional information to the user object.
-                auto editorDbo = addNew<Editor>();
-                auto editor = editorDbo.modify();
-                editor->name = "Administrator";
-                editor->handle = "administrator";
-                editor->avatar = AvatarGenerator(128.0).generate(editor->name.toUTF8());
-                editor->role = Editor::Role::Admin;
-
-                // Get a record to authInfo for given user.
-                auto userAuthInfoDbo = _users.find(user);
-                // Modify given record.
-                auto userAuthInfo = userAuthInfoDbo.modify();
-                // Associate editor object with user authInfo
-                userAuthInfo->setUser(editorDbo);
-
-                // Create first post.
-                auto postDbo = addNew<Post>();
-                auto post = postDbo.modify();
-                post->author = editorDbo;
-                post->title = "It's alive!";
-                post->intro = "This is introduction to the post.";
-                post->content = "Seems like this is a clean instance of your brand new CMS. Go to settings and configure it to your needs.";
-                post->created = post->published = Wt::WDateTime::currentDateTime();
-                post->visibility = Post::Visibility::Published;
-            }
-        }
-        catch (const Wt::Dbo::Exception& e)
-        {
-            std::cerr << "Database exception: " << e.what() << std::endl << tableCreationSql() << std::endl;
-            std::cerr << "Using existing database." << std::endl;
-        }
-
-        g_bDatabaseInitialized = true;
-    }
+}
 
-    try
-    {
-        tryQuery([=] { addNew<ConfigStore>(ConfigKeys::SiteName, "cxxblog", ".+"); });
-        tryQuery([=] { addNew<ConfigStore>(ConfigKeys::SiteAbout, "This is a new instance of cxxblog."); });
-        tryQuery([=] { addNew<ConfigStore>(ConfigKeys::SiteFooter, "Powered by [cxxblog](https://github.com/adrian-007/cxxblog)"); });
-        tryQuery([=] { addNew<ConfigStore>(ConfigKeys::SiteDisqusShortname, "", "^$|^[a-zA-Z0-9]+[a-zA-Z0-9-.]+[a-zA-Z0-9]+$"); });
+BasicSession& Session::readSession()
+{
+    if (_login.loggedIn() || !_separateReadPool)
+        return *this;
 
-        // Try to create default keys.
-        dbo::Transaction t { *this };
+    if (!_readSession)
+        _readSession = std::make_unique<BasicSession>(_dbReadConnectionPool);
 
-        auto results { find<ConfigStore>().where("key like 'site.%'").resultList() };
-        for (auto& cs : results)
-        {
-            if (cs->key == ConfigKeys::SiteName)
-            {
-                _siteConfig._siteName = std::move(cs);
-            }
-            else if (cs->key == ConfigKeys::SiteAbout)
-            {
-                _siteConfig._about = std::move(cs);
-            }
-            else if (cs->key == ConfigKeys::SiteFooter)
-            {
-                _siteConfig._footer = std::move(cs);
-            }
-            else if (cs->key == ConfigKeys::SiteDisqusShortname)
-            {
-                _siteConfig._disqusShortname = std::move(cs);
-            }
-        }
+    return *_readSession;
+}
 
-        assert(_siteConfig._siteName);
-        assert(_siteConfig._about);
-        assert(_siteConfig._footer);
-        assert(_siteConfig._disqusShortname);
-    }
-    catch (const std::exception& e)
-    {
-        wApp->log("error") << e.what();
-    }
+void Session::createDefaultContent()
+{
+    // Register a default user account.
+    auto user = _users.registerNew();
+
+    // Set login as identity.
+    user.addIdentity(Wt::Auth::Identity::LoginName, "admin");
+
+    // Activate the first user.
+    user.setStatus(Wt::Auth::AccountStatus::Normal);
+    // Set user password.
+    passwordService().updatePassword(user, "admin");
+
+    // Set up Editor object that adds additional information to the user object.
+    auto editorDbo = addNew<Editor>();
+    auto editor = editorDbo.modify();
+    editor->name = "Administrator";
+    editor->handle = "administrator";
+    editor->avatar = AvatarGenerator(128.0).generate(editor->name.toUTF8());
+    editor->role = Editor::Role::Admin;
+
+    // Get a record to authInfo for given user.
+    auto userAuthInfoDbo = _users.find(user);
+    // Modify given record.
+    auto userAuthInfo = userAuthInfoDbo.modify();
+    // Associate editor object with user authInfo
+    userAuthInfo->setUser(editorDbo);
+
+    // Create first post.
+    auto postDbo = addNew<Post>();
+    auto post = postDbo.modify();
+    post->author = editorDbo;
+    post->title = "It's alive!";
+    post->intro = "This is introduction to the post.";
+    post->content = "Seems like this is a clean instance of your brand new CMS. Go to settings and configure it to your needs.";
+    post->created = post->published = Wt::WDateTime::currentDateTime();
+    post->visibility = Post::Visibility::Published;
 }
 
 std::string Session::relativePath(const std::string& path) const
@@ -275,7 +195,7 @@ std::unique_ptr<Wt::Auth::AuthWidget> Session::createAuthWidget()
     return authWidget;
 }
 
-std::unique_ptr<Wt::Dbo::SqlConnectionPool> Session::createConnectionPool(DBConnectionInfo info)
+std::unique_ptr<Wt::Dbo::SqlConnection> Session::createConnection(DBConnectionInfo info)
 {
     using namespace Wt::Dbo;
     std::unique_ptr<SqlConnection> connection;
@@ -286,7 +206,6 @@ std::unique_ptr<Wt::Dbo::SqlConnectionPool> Session::createConnectionPool(DBConn
         throw std::runtime_error("Wt::Dbo was not compiled with SQLite support.");
 #else
         auto backend { std::make_unique<backend::Sqlite3>(info.dbName) };
-        backend->setProperty("show-queries", "true");
         backend->setDateTimeStorage(SqlDateTimeType::DateTime, backend::DateTimeStorage::PseudoISO8601AsText);
         connection = std::move(backend);
 #endif
@@ -343,7 +262,61 @@ std::unique_ptr<Wt::Dbo::SqlConnectionPool> Session::createConnectionPool(DBConn
     }
 
     assert(connection != nullptr);
-    return std::make_unique<FixedSqlConnectionPool>(std::move(connection), 10);
+    return std::make_unique<InstrumentedConnection>(std::move(connection));
+}
+
+ConnectionPools Session::createConnectionPools(DBConnectionInfo info)
+{
+    auto connection = createConnection(info);
+    ConnectionPools pools;
+
+    if (info.dbType == "sqlite")
+    {
+        // SQLite allows a single writer at a time anyway, so writes go through one connection and reads are
+        // spread across read-only (query_only) connections, without contending for the write lock. Only editors'
+        // sessions use the writer for reading, anonymous readers go through Session::readSession().
+        auto writerOptions = info.poolOptions;
+        writerOptions.setupStatements = ConnectionPool::sqliteProfile();
+        writerOptions.size = 1u;
+        writerOptions.warmUp = 1u;
+
+        auto readerOptions = info.poolOptions;
+        readerOptions.setupStatements = ConnectionPool::sqliteProfile();
+        readerOptions.size = info.readPoolSize;
+        readerOptions.readOnly = true;
+
+        pools.reader = std::make_unique<ConnectionPool>(connection->clone(), readerOptions);
+        pools.writer = std::make_unique<ConnectionPool>(std::move(connection), writerOptions);
+    }
+    else
+    {
+        pools.writer = std::make_unique<ConnectionPool>(std::move(connection), info.poolOptions);
+
+        if (!info.dbReplicaHost.empty())
+        {
+            auto replicaInfo = info;
+            replicaInfo.dbHost = info.dbReplicaHost;
+            replicaInfo.dbPort = info.dbReplicaPort;
+
+            // Replica connections are opened on demand, so an unreachable replica does not delay the first request.
+            auto replicaOptions = info.poolOptions;
+            replicaOptions.size = info.readPoolSize;
+            replicaOptions.warmUp = 0u;
+
+            try
+            {
+                pools.reader = std::make_unique<ConnectionPool>(createConnection(std::move(replicaInfo)), replicaOptions);
+                pools.replica = std::make_unique<ReplicaConnectionPool>(*pools.reader, *pools.writer, info.replicaRetryDelay);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Failed to connect to read replica, reads will use primary database: " << e.what() << std::endl;
+                pools.reader.reset();
+            }
+        }
+    }
+
+    return pools;
 }
 
 void Session::initAuthServices()
@@ -25,10 +25,13 @@
 
 #include <Wt/Dbo/ptr.h>
 
+#include <chrono>
 #include <memory>
 #include "BasicSession.h"
 
 #include "SiteConfig.h"
+#include "ConnectionPool.h"
+#include "ReplicaConnectionPool.h"
 #include "ApplicationExceptions.h"
 #include "Editor.h"
 
@@ -42,25 +45,78 @@ struct DBConnectionInfo
     std::string dbUsername;
     std::string dbPassword;
     std::string dbName;
+
+    // Read replica, other settings are shared with the primary (not used with SQLite).
+    std::string dbReplicaHost;
+    std::string dbReplicaPort;
+    std::chrono::seconds replicaRetryDelay { 30 };
+
+    ConnectionPool::Options poolOptions;
+    // Size of the read-only pool: local read-only connections for SQLite, replica connections otherwise.
+    std::size_t readPoolSize = 10u;
+};
+
+struct ConnectionPools
+{
+    std::unique_ptr<ConnectionPool> writer;
+    // Separate pool of read-only connections. When null, reads go through the writer pool.
+    std::unique_ptr<ConnectionPool> reader;
+    // Routes reads to the replica (reader) with fall back to the writer, set only when replica is configured.
+    std::unique_ptr<ReplicaConnectionPool> replica;
+
+    dbo::SqlConnectionPool& read() const
+    {
+        if (replica)
+            return *replica;
+
+        if (reader)
+            return *reader;
+
+        return *writer;
+    }
+
+    /**
+     * Pool for reads which have to see every committed change, e.g. ones filling caches that are invalidated on
+     * writes. Replica could still serve data from before the invalidation, so it is never used here.
+     */
+    ConnectionPool& consistentRead() const
+    {
+        return (reader && !replica) ? *reader : *writer;
+    }
 };
 
 class Session
     : public BasicSession
 {
 public:
-    Session(const std::string& basePath, Wt::Dbo::SqlConnectionPool& dbConnectionPool);
+    Session(const std::string& basePath, const std::string& siteUrl, Wt::Dbo::SqlConnectionPool& dbConnectionPool, Wt::Dbo::SqlConnectionPool& dbReadConnectionPool);
 
     std::string relativePath(const std::string& path) const;
     std::string relativePath(const std::initializer_list<std::string>& parts) const;
 
     inline const auto& basePath() const { return _basePath; }
-    inline auto& siteConfig() { return _siteConfig; }
+    // Configured scheme and host for absolute links, without trailing slash.
+    inline const auto& siteUrl() const { return _siteUrl; }
+    inline auto siteConfig() const { return SiteConfig::current(); }
 
     inline auto& login() { return _login; }
     inline auto& users() { return _users; }
 
     dbo::ptr<Editor> editor();
 
+    /**
+     * Session for reads that tolerate replication lag. While nobody is logged in it uses the read pool (replica or
+     * read-only SQLite connections), otherwise it is this session, so editors always see their own changes.
+     * Objects loaded through it have to be accessed within its own transaction.
+     */
+    BasicSession& readSession();
+
+    /**
+     * Creates the default admin account and the first post. Used when a new database is set up, has to be called
+     * within a transaction.
+     */
+    void createDefaultContent();
+
     Wt::Auth::PasswordResult updateCredentials(const Wt::Auth::Login& login, const Wt::WString& currentPassword, const Wt::WString& newUsername, const Wt::WString& newPassword);
 
     /**
@@ -70,16 +126,22 @@ public:
 
     std::unique_ptr<Wt::Auth::AuthWidget> createAuthWidget();
 
-    static std::unique_ptr<Wt::Dbo::SqlConnectionPool> createConnectionPool(DBConnectionInfo info);
+    static ConnectionPools createConnectionPools(DBConnectionInfo info);
     static void initAuthServices();
 
 private:
+    static std::unique_ptr<Wt::Dbo::SqlConnection> createConnection(DBConnectionInfo info);
+
     static Wt::Auth::AuthService& authService();
     static Wt::Auth::PasswordService& passwordService();
 
     const std::string& _basePath;
-    SiteConfig _siteConfig;
+    const std::string& _siteUrl;
 
     Wt::Auth::Dbo::UserDatabase<EditorAuthInfo> _users;
     Wt::Auth::Login _login;
+
+    Wt::Dbo::SqlConnectionPool& _dbReadConnectionPool;
+    const bool _separateReadPool;
+    std::unique_ptr<BasicSession> _readSession;
 };
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SiteConfig.h"
+
+#include <Wt/Dbo/Dbo.h>
+
+#include <atomic>
+#include <set>
+
+namespace
+{
+    struct DefaultValue
+    {
+        std::string_view key;
+        const char* value;
+        const char* valueRegex;
+    };
+
+    const DefaultValue g_DefaultValues[] = {
+        { ConfigKeys::SiteName, "cxxblog", ".+" },
+        { ConfigKeys::SiteAbout, "This is a new instance of cxxblog.", "" },
+        { ConfigKeys::SiteFooter, "Powered by [cxxblog](https://github.com/adrian-007/cxxblog)", "" },
+        { ConfigKeys::SiteDisqusShortname, "", "^$|^[a-zA-Z0-9]+[a-zA-Z0-9-.]+[a-zA-Z0-9]+$" },
+    };
+}
+
+SiteConfig::SiteConfig()
+{
+    for (const auto& defaultValue : g_DefaultValues)
+        *value(defaultValue.key) = { defaultValue.value, defaultValue.valueRegex };
+}
+
+std::shared_ptr<const SiteConfig>& SiteConfig::snapshot()
+{
+    // Defaults are used until configuration is loaded, so there always is a snapshot to read.
+    static std::shared_ptr<const SiteConfig> snapshot { new SiteConfig() };
+    return snapshot;
+}
+
+std::shared_ptr<const SiteConfig> SiteConfig::current()
+{
+    return std::atomic_load(&snapshot());
+}
+
+void SiteConfig::publish(std::shared_ptr<const SiteConfig> siteConfig)
+{
+    std::atomic_store(&snapshot(), std::move(siteConfig));
+}
+
+void SiteConfig::load(dbo::Session& session)
+{
+    std::shared_ptr<SiteConfig> siteConfig { new SiteConfig() };
+    std::set<std::string, std::less<>> existingKeys;
+
+    for (const auto& configStore : session.find<ConfigStore>().where("key like 'site.%'").resultList())
+    {
+        if (auto configValue = siteConfig->value(configStore->key))
+            *configValue = { configStore->value, configStore->valueRegex };
+
+        existingKeys.insert(configStore->key);
+    }
+
+    for (const auto& defaultValue : g_DefaultValues)
+    {
+        if (existingKeys.find(defaultValue.key) == existingKeys.end())
+            session.addNew<ConfigStore>(defaultValue.key, defaultValue.value, defaultValue.valueRegex);
+    }
+
+    siteConfig->_version = current()->_version + 1;
+    publish(std::move(siteConfig));
+}
+
+std::shared_ptr<const SiteConfig> SiteConfig::store(dbo::Session& session, std::string siteName, std::string about, std::string footer, std::string disqusShortname)
+{
+    std::shared_ptr<SiteConfig> siteConfig { new SiteConfig(*current()) };
+
+    siteConfig->_siteName.value = std::move(siteName);
+    siteConfig->_about.value = std::move(about);
+    siteConfig->_footer.value = std::move(footer);
+    siteConfig->_disqusShortname.value = std::move(disqusShortname);
+    siteConfig->_version++;
+
+    for (const auto& defaultValue : g_DefaultValues)
+    {
+        const auto& configValue = *siteConfig->value(defaultValue.key);
+        auto configStore = session.find<ConfigStore>().where("key = ?").bind(std::string { defaultValue.key }).resultValue();
+
+        if (configStore)
+            configStore.modify()->value = configValue.value;
+        else
+            session.addNew<ConfigStore>(defaultValue.key, configValue.value, configValue.valueRegex);
+    }
+
+    return siteConfig;
+}
+
+SiteConfig::Value* SiteConfig::value(const std::string_view& key)
+{
+    if (key == ConfigKeys::SiteName)
+        return &_siteName;
+    else if (key == ConfigKeys::SiteAbout)
+        return &_about;
+    else if (key == ConfigKeys::SiteFooter)
+        return &_footer;
+    else if (key == ConfigKeys::SiteDisqusShortname)
+        return &_disqusShortname;
+
+    return nullptr;
+}
@@ -20,37 +20,62 @@
 
 #include "ConfigStore.h"
 
-class Session;
+#include <Wt/Dbo/Session.h>
 
-struct SiteConfig
+#include <cstdint>
+#include <memory>
+
+/**
+ * Immutable snapshot of site configuration, shared by all sessions. It is loaded once per process and replaced
+ * as a whole when settings are saved, so sessions don't touch the database to read it.
+ */
+class SiteConfig
 {
-    SiteConfig(const SiteConfig&) = delete;
-    SiteConfig& operator=(const SiteConfig&) = delete;
-    SiteConfig& operator=(SiteConfig&&) = delete;
+public:
+    static std::shared_ptr<const SiteConfig> current();
+
+    /**
+     * Loads configuration and stores default values of missing keys. Has to be called within a transaction.
+     */
+    static void load(dbo::Session& session);
+
+    /**
+     * Writes given values to the database and returns a snapshot with those values, which should be published
+     * once the transaction is committed. Has to be called within a transaction.
+     */
+    static std::shared_ptr<const SiteConfig> store(dbo::Session& session, std::string siteName, std::string about, std::string footer, std::string disqusShortname);
+    static void publish(std::shared_ptr<const SiteConfig> siteConfig);
 
-    auto siteName() const { return _siteName->value; }
-    void siteName(std::string value) { _siteName.modify()->value = std::move(value); }
-    auto siteNameRegex() const { return _siteName->valueRegex; }
+    auto version() const { return _version; }
 
-    auto about() const { return _about->value; }
-    void about(std::string value) { _about.modify()->value = std::move(value); }
-    auto aboutRegex() const { return _about->valueRegex; }
+    const auto& siteName() const { return _siteName.value; }
+    const auto& siteNameRegex() const { return _siteName.valueRegex; }
 
-    auto footer() const { return _footer->value; }
-    void footer(std::string value) { _footer.modify()->value = std::move(value); }
-    auto footerRegex() const { return _footer->valueRegex; }
+    const auto& about() const { return _about.value; }
+    const auto& aboutRegex() const { return _about.valueRegex; }
 
-    auto disqusShortname() const { return _disqusShortname->value; }
-    void disqusShortname(std::string value) { _disqusShortname.modify()->value = std::move(value); }
-    auto disqusShortnameRegex() const { return _disqusShortname->valueRegex; }
+    const auto& footer() const { return _footer.value; }
+    const auto& footerRegex() const { return _footer.valueRegex; }
+
+    const auto& disqusShortname() const { return _disqusShortname.value; }
+    const auto& disqusShortnameRegex() const { return _disqusShortname.valueRegex; }
 
 private:
-    friend class Session;
+    struct Value
+    {
+        std::string value;
+        std::string valueRegex;
+    };
+
+    SiteConfig();
+
+    static std::shared_ptr<const SiteConfig>& snapshot();
+    Value* value(const std::string_view& key);
 
-    SiteConfig() = default;
+    uint64_t _version = 0u;
 
-    dbo::ptr<ConfigStore> _siteName;
-    dbo::ptr<ConfigStore> _about;
-    dbo::ptr<ConfigStore> _footer;
-    dbo::ptr<ConfigStore> _disqusShortname;
+    Value _siteName;
+    Value _about;
+    Value _footer;
+    Value _disqusShortname;
 };
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "Tag.h"
+#include "Post.h"
+
+#include <Wt/Dbo/Dbo.h>
+
+namespace
+{
+    constexpr auto g_MaxTagNameLength = 32u;
+}
+
+DBO_INSTANTIATE_TEMPLATES(Tag)
+
+std::string Tag::normalize(const std::string& name)
+{
+    std::string result;
+
+    for (auto c : name)
+    {
+        if (result.size() >= g_MaxTagNameLength)
+            break;
+
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+            result += c;
+        else if (c >= 'A' && c <= 'Z')
+            result += static_cast<char>(c - 'A' + 'a');
+        else if (!result.empty() && result[result.size() - 1] != '-')
+            result += '-';
+    }
+
+    while (!result.empty() && result[result.size() - 1] == '-')
+        result.erase(result.size() - 1, 1);
+
+    return result;
+}
+
+std::string Tag::url() const
+{
+    return "tag/" + name.toUTF8();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/Dbo/Types.h>
+#include <Wt/Dbo/WtSqlTraits.h>
+
+#include <Wt/WString.h>
+
+#include <string>
+
+namespace dbo = Wt::Dbo;
+
+class Post;
+
+class Tag
+    : public dbo::Dbo<Tag>
+{
+public:
+    Wt::WString name;
+
+    dbo::collection<dbo::ptr<Post>> posts;
+
+    template<class Action>
+    void persist(Action& a)
+    {
+        dbo::field(a, name, "name");
+        dbo::hasMany(a, posts, dbo::ManyToMany, "post_tag");
+    }
+
+    /**
+     * Converts user input to tag name: lower-case alphanumeric characters and dashes, at most 32 characters.
+     * Returns empty string if nothing is left.
+     */
+    [[nodiscard]] static std::string normalize(const std::string& name);
+
+    [[nodiscard]] std::string url() const;
+};
+
+DBO_EXTERN_TEMPLATES(Tag)
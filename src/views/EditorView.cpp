@@ -31,7 +31,8 @@ EditorView::EditorView(Session& session, dbo::ptr<Editor> editor)
     , _session(session)
     , _editor(std::move(editor))
 {
-    dbo::Transaction t { _session };
+    // Editor was loaded through the read session.
+    dbo::Transaction t { _session.readSession() };
 
     Wt::WLink avatarLink { Wt::LinkType::Url, _session.relativePath("avatar/" + _editor->handle.toUTF8()) };
     bindNew<Wt::WImage>("avatar", avatarLink);
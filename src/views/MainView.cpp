@@ -22,6 +22,9 @@
 #include "PostsListView.h"
 #include "PostView.h"
 #include "EditorView.h"
+#include "SearchView.h"
+#include "TagView.h"
+#include "SnapshotResource.h"
 #include "Markdown.h"
 
 #include <Wt/WApplication.h>
@@ -33,6 +36,8 @@
 #include <Wt/WPopupMenu.h>
 #include <Wt/WLogger.h>
 #include <Wt/WStackedWidget.h>
+#include <Wt/WEnvironment.h>
+#include <Wt/Utils.h>
 
 #define LOG() wApp->log("MainView")
 
@@ -52,7 +57,7 @@ MainView::MainView(Session& session, Wt::Dbo::SqlConnectionPool& dbConnectionPoo
     app->require("assets/js/highlight.min.js");
     app->require("assets/js/cxxblog.js");
 
-    if (auto disqusShortname = session.siteConfig().disqusShortname(); !disqusShortname.empty())
+    if (auto disqusShortname = session.siteConfig()->disqusShortname(); !disqusShortname.empty())
     {
         // Create a stub function, we'll be using DISQUS.reset anyway.
         app->doJavaScript("var disqus_config = function () { };");
@@ -64,13 +69,13 @@ MainView::MainView(Session& session, Wt::Dbo::SqlConnectionPool& dbConnectionPoo
     auto view = std::make_unique<Wt::WTemplate>(tr("mainView"));
 
     view->bindEmpty("content");
-    view->bindString("footer", Markdown(_session.siteConfig().footer()).renderHTML());
+    view->bindString("footer", Markdown(_session.siteConfig()->footer()).renderHTML());
 
     {
         _navBar = view->bindNew<Wt::WNavigationBar>("navbar");
         _navBar->addStyleClass("navbar-fixed-top");
 
-        _navBar->setTitle(_session.siteConfig().siteName(), Wt::WLink(Wt::LinkType::InternalPath, _session.basePath()));
+        _navBar->setTitle(_session.siteConfig()->siteName(), Wt::WLink(Wt::LinkType::InternalPath, _session.basePath()));
         _navBar->setResponsive(true);
 
         _navigationMenu = _navBar->addMenu(createNavigationMenu(false), Wt::AlignmentFlag::Right);
@@ -108,6 +113,9 @@ void MainView::onLoginStateChanged()
         {
             LOG() << "User logged in: " << editor->name;
             app->changeSessionId();
+
+            // Static page resources hand requests carrying this cookie over to the application.
+            app->setCookie(SnapshotResource::EditorCookieName, "1", 30 * 24 * 3600, "", _session.basePath());
             auto nextPart { app->internalPathNextPart(_session.basePath()) };
 
             if (nextPart == loginPath())
@@ -118,6 +126,8 @@ void MainView::onLoginStateChanged()
     {
         LOG() << "User logged out.";
         app->changeSessionId();
+
+        app->removeCookie(SnapshotResource::EditorCookieName, "", _session.basePath());
         navigateToBasePath = true;
     }
 
@@ -153,9 +163,12 @@ void MainView::onInternalPathChanged(const std::string& internalPath)
         {
             path = app->internalPathNextPart(_session.basePath() + path + '/');
 
-            dbo::Transaction t { _session };
+            // Post and everything loaded through it belong to the read session, which PostView keeps using
+            // while showing the post to anonymous readers.
+            auto& session = _session.readSession();
+            dbo::Transaction t { session };
 
-            auto query = _session.find<Post>();
+            auto query = session.find<Post>();
             query.where("id = ?").bind(path);
 
             if (!_session.login().loggedIn())
@@ -174,13 +187,42 @@ void MainView::onInternalPathChanged(const std::string& internalPath)
             auto title = post->title;
             bindContent(title, PostView::createNew(_session, std::move(post)));
         }
+        else if (path == "search")
+        {
+            auto prefix = _session.basePath() + path + '/';
+            std::string query;
+
+            if (app->internalPathMatches(prefix))
+                query = Wt::Utils::urlDecode(app->internalPath().substr(prefix.size()));
+            else if (auto parameter = app->environment().getParameter("q"))
+                query = *parameter;
+
+            bindContent(tr("str.search"), SearchView::createNew(_session, query));
+        }
+        else if (path == "tag")
+        {
+            auto tag = app->internalPathNextPart(_session.basePath() + path + '/');
+            auto before = app->internalPathNextPart(_session.basePath() + path + '/' + tag + '/');
+
+            // Up to 18 digits always fit into long long.
+            if (tag.empty() || before.size() > 18 || before.find_first_not_of("0123456789") != std::string::npos)
+                throw PageNotFoundException();
+
+            if (_navigationMenu != nullptr)
+                _navigationMenu->select(nullptr);
+
+            auto title = tr("str.taggedPosts").arg(tag);
+            bindContent(title, TagView::createNew(_session, tag, before.empty() ? 0 : std::stoll(before)));
+        }
         else if (path == "people")
         {
             auto editorHandle = app->internalPathNextPart(_session.basePath() + path + '/');
 
-            dbo::Transaction t { _session };
+            // Editor is shown from the read session, EditorView keeps using it, see the post page above.
+            auto& session = _session.readSession();
+            dbo::Transaction t { session };
 
-            auto editor = _session.find<Editor>().where("handle = ?").bind(editorHandle).resultValue();
+            auto editor = session.find<Editor>().where("handle = ?").bind(editorHandle).resultValue();
 
             if (!editor)
                 throw PageNotFoundException();
@@ -255,10 +297,15 @@ std::unique_ptr<Wt::WMenu> MainView::createNavigationMenu(bool editor /*= false*
 
     addMenuItem("str.about", "about", [=](auto item)
     {
-        auto content = Markdown(_session.siteConfig().about()).renderHTML();
+        auto content = Markdown(_session.siteConfig()->about()).renderHTML();
         bindStringContent(item->text(), content);
     });
 
+    addMenuItem("str.search", "search", [=](auto item)
+    {
+        bindContent(item->text(), SearchView::createNew(_session, std::string {}));
+    });
+
     if (!editor)
     {
         return menu;
@@ -303,20 +350,20 @@ void MainView::setPageMessage(const std::string& message)
 {
     assert(_view != nullptr);
 
-    wApp->setTitle(_session.siteConfig().siteName() + " - " + message);
+    wApp->setTitle(_session.siteConfig()->siteName() + " - " + message);
     auto view =_view->bindNew<Wt::WTemplate>("content", tr("mainView.errorMessage"));
     view->bindString("errorMessage", message);
 }
 
 void MainView::bindContent(const Wt::WString& title, std::unique_ptr<Wt::WWidget> contentWidget)
 {
-    wApp->setTitle(title.empty() ? _session.siteConfig().siteName() : tr("str.pageSubtitle").arg(_session.siteConfig().siteName()).arg(title));
+    wApp->setTitle(title.empty() ? _session.siteConfig()->siteName() : tr("str.pageSubtitle").arg(_session.siteConfig()->siteName()).arg(title));
     _view->bindWidget("content", std::move(contentWidget));
 }
 
 void MainView::bindStringContent(const Wt::WString& title, const Wt::WString& text)
 {
-    wApp->setTitle(title.empty() ? _session.siteConfig().siteName() : tr("str.pageSubtitle").arg(_session.siteConfig().siteName()).arg(title));
+    wApp->setTitle(title.empty() ? _session.siteConfig()->siteName() : tr("str.pageSubtitle").arg(_session.siteConfig()->siteName()).arg(title));
     _view->bindString("content", text);
 }
 
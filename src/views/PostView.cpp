@@ -19,11 +19,18 @@
 #include "PostView.h"
 #include "Markdown.h"
 #include "ExpressionParser.h"
+#include "ImageExpression.h"
 #include "ValidatorUtils.h"
 #include "NotificationDialog.h"
 #include "ManageAttachmentsDialog.h"
+#include "SearchBackend.h"
+#include "TagCache.h"
+#include "FeedCache.h"
+#include "SnapshotCache.h"
+#include "SitemapIndex.h"
 
 #include "models/Attachment.h"
+#include "models/Tag.h"
 
 #include <Wt/WToolBar.h>
 #include <Wt/WPushButton.h>
@@ -38,10 +45,9 @@
 #include <Wt/Utils.h>
 #include <Wt/WAnchor.h>
 #include <Wt/WLink.h>
-#include <Wt/WEnvironment.h>
 
 #include <variant>
-#include <numeric>
+#include <sstream>
 
 #include <boost/format.hpp>
 
@@ -57,27 +63,62 @@ namespace
         });
     )jsCode";
 
+    // Keeps structures derived from posts in sync, has to be called after post changes are committed.
+    void onPostChanged(const dbo::ptr<Post>& post)
+    {
+        SearchBackend::instance().update(post);
+        TagCache::instance().invalidate();
+        FeedCache::instance().invalidate();
+        SnapshotCache::instance().invalidate();
+        SitemapIndex::instance().update(post);
+    }
+
+    std::vector<std::string> splitTags(const Wt::WString& text)
+    {
+        std::vector<std::string> names;
+        std::istringstream stream { text.toUTF8() };
+
+        for (std::string name; std::getline(stream, name, ',');)
+            names.emplace_back(std::move(name));
+
+        return names;
+    }
+
+    std::string joinTags(const std::vector<std::string>& names)
+    {
+        std::string text;
+
+        for (const auto& name : names)
+            text += text.empty() ? name : ", " + name;
+
+        return text;
+    }
+
     struct DraftFormModel : public Wt::WFormModel
     {
         static Field TitleField;
         static Field IntroField;
         static Field ContentField;
+        static Field TagsField;
 
         DraftFormModel() : Wt::WFormModel()
         {
             addField(TitleField);
             addField(IntroField);
             addField(ContentField);
+            addField(TagsField);
 
             setValidator(TitleField, MakeMandatoryValidator<Wt::WLengthValidator>(1, 100));
             setValidator(IntroField, MakeMandatoryValidator<Wt::WLengthValidator>(1, 600));
             setValidator(ContentField, MakeMandatoryValidator<Wt::WLengthValidator>(1, std::numeric_limits<int>::max()));
+            setValidator(TagsField, std::make_shared<Wt::WLengthValidator>(0, 300));
         }
     };
 
     DraftFormModel::Field DraftFormModel::TitleField = "title";
     DraftFormModel::Field DraftFormModel::IntroField = "intro";
     DraftFormModel::Field DraftFormModel::ContentField = "content";
+    DraftFormModel::Field DraftFormModel::TagsField = "tags";
 
     struct DraftFormView : public Wt::WTemplateFormView
     {
@@ -88,9 +129,12 @@ namespace
                 _currentDraft = dbo::ptr<PostDraft>(std::make_unique<PostDraft>(std::move(post)));
             }
 
-            _model->setValue(DraftFormModel::TitleField, _currentDraft->title);
-            _model->setValue(DraftFormModel::IntroField, _currentDraft->intro);
-            _model->setValue(DraftFormModel::ContentField, _currentDraft->content);
+            auto revision = _currentDraft->revision();
+
+            _model->setValue(DraftFormModel::TitleField, revision.title);
+            _model->setValue(DraftFormModel::IntroField, revision.intro);
+            _model->setValue(DraftFormModel::ContentField, revision.content);
+            _model->setValue(DraftFormModel::TagsField, Wt::WString::fromUTF8(_currentDraft->post ? joinTags(_currentDraft->post->tagNames()) : ""));
 
             setTemplateText(tr("postView.edit"));
             addFunction("id", &Wt::WTemplate::Functions::id);
@@ -101,6 +145,7 @@ namespace
             auto contentTextArea { std::make_unique<Wt::WTextArea>() };
             contentTextArea->resize("auto", 400);
             setFormWidget(DraftFormModel::ContentField, std::move(contentTextArea));
+            setFormWidget(DraftFormModel::TagsField, std::make_unique<Wt::WLineEdit>());
 
             updateView(_model.get());
         }
@@ -122,6 +167,7 @@ namespace
                 auto title = _model->valueText(DraftFormModel::TitleField).trim();
                 auto intro = _model->valueText(DraftFormModel::IntroField).trim();
                 auto content = _model->valueText(DraftFormModel::ContentField).trim();
+                auto tags = splitTags(_model->valueText(DraftFormModel::TagsField));
 
                 dbo::Transaction t { _session };
                 auto draftDbo { _currentDraft };
@@ -138,32 +184,58 @@ namespace
                     post->title = title;
                     post->intro = intro;
                     post->content = content;
+                    post->setTags(tags);
 
                     draftDbo.remove();
                     t.commit();
 
+                    onPostChanged(postDbo);
+
                     return postDbo;
                 }
                 else
                 {
-                    auto draftChanged = title != draftDbo->title || intro != draftDbo->intro || content != draftDbo->content;
+                    auto current = draftDbo->revision();
+                    auto draftChanged = title != current.title || intro != current.intro || content != current.content;
+                    // Tags are not versioned, they are applied to the post right away. The post is only marked
+                    // dirty when they differ, otherwise every draft save would update the post row.
+                    auto tagNames = Post::normalizeTagNames(tags);
+                    auto tagsChanged = tagNames != draftDbo->post->tagNames();
+
+                    if (tagsChanged)
+                        draftDbo->post.modify()->setTags(tagNames);
 
                     if (draftChanged)
                     {
-                        auto targetDraftDbo { _session.addNew<PostDraft>(std::move(draftDbo)) };
+                        // Has to be fetched before the new draft is added, since new draft is stored relative to it.
+                        auto previousDraftDbo = draftDbo->post->latestDraft();
+
+                        auto targetDraftDbo { _session.addNew<PostDraft>(draftDbo->post) };
                         auto draft { targetDraftDbo.modify() };
 
-                        draft->title = title;
-                        draft->intro = intro;
-                        draft->content = content;
+                        draft->setRevision({ title, intro, content }, previousDraftDbo);
                         draft->created = Wt::WDateTime::currentDateTime();
 
+                        // Draft retention is enforced here, so read path does not need to modify anything.
+                        draft->post->pruneDrafts();
+
                         t.commit();
 
+                        if (tagsChanged)
+                            onPostChanged(draftDbo->post);
+
                         _currentDraft = targetDraftDbo;
                         return targetDraftDbo;
                     }
 
+                    if (tagsChanged)
+                    {
+                        t.commit();
+                        onPostChanged(draftDbo->post);
+
+                        return draftDbo->post;
+                    }
+
                     return dbo::ptr<PostDraft>{};
                 }
             }
@@ -181,6 +253,40 @@ namespace
 
         dbo::ptr<PostDraft> _currentDraft;
     };
+
+    /**
+     * Renders expressions for the post shown in application session, links are relative to session's base path.
+     */
+    class ExpressionContext
+        : public ExpressionParser::Context
+    {
+    public:
+        ExpressionContext(Session& session, const std::vector<long long>& imageIds)
+            : _session(session)
+            , _images(session.readSession(), imageIds)
+        { }
+
+        std::string image(const std::string& id, const std::string& caption) const override
+        {
+            try
+            {
+                if (!_images.isImage(id))
+                    return {};
+
+                return ImageExpression::render(_session.relativePath({ "attachment", id }), ImageExpression::captionHtml(caption));
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Failed to render image " << id << ": " << e.what() << std::endl;
+            }
+
+            return {};
+        }
+
+    private:
+        Session& _session;
+        ImageExpression _images;
+    };
 }
 
 PostView::PostView(Session& session, dbo::ptr<Post> post)
@@ -207,7 +313,9 @@ PostView::PostView(Session& session, dbo::ptr<Post> post)
             {
                 _currentDraft = latestDrafts.front();
 
-                if (_currentDraft->title == _post->title && _currentDraft->intro == _post->intro && _currentDraft->content == _post->content)
+                auto revision = _currentDraft->revision();
+
+                if (revision.title == _post->title && revision.intro == _post->intro && revision.content == _post->content)
                     _currentDraft = {};
             }
 
@@ -216,7 +324,7 @@ PostView::PostView(Session& session, dbo::ptr<Post> post)
     }
     catch (const AccessDeniedException&)
     {
-        dbo::Transaction t { _session };
+        dbo::Transaction t { _session.readSession() };
         if (!_post)
             throw PageNotFoundException(wApp->internalPath());
 
@@ -400,6 +508,8 @@ void PostView::onToggleVisibility()
 
         t.commit();
 
+        onPostChanged(_post);
+
         NotificationDialog::show(this, tr("str.postVisibilityStatusUpdatedNotificationTitle"), notificationMessage);
     }
     catch (const std::exception&)
@@ -418,7 +528,7 @@ void PostView::onToggleEditSave()
 
             if (std::holds_alternative<dbo::ptr<Post>>(result))
             {
-                // A new post.
+                // A new post, or an existing post with only its tags changed.
                 auto post = std::get<dbo::ptr<Post>>(result);
 
                 if (post)
@@ -494,15 +604,17 @@ void PostView::onSaveDraftAsPost()
 
         dbo::Transaction t { _session };
 
-        auto draft = _currentDraft.modify();
+        auto revision = _currentDraft->revision();
         auto post = _post.modify();
 
-        post->title = draft->title;
-        post->intro = draft->intro;
-        post->content = draft->content;
+        post->title = std::move(revision.title);
+        post->intro = std::move(revision.intro);
+        post->content = std::move(revision.content);
 
         t.commit();
 
+        onPostChanged(_post);
+
         _currentDraft = {};
 
         NotificationDialog::show(this, tr("str.draftSavedAsPostNotificationTitle"), tr("str.draftSavedAsPostNotificationMessage"));
@@ -548,9 +660,16 @@ void PostView::onDeletePost()
             try
             {
                 dbo::Transaction t { _session };
+                auto postId = _post.id();
                 _post.remove();
                 t.commit();
 
+                SearchBackend::instance().remove(postId);
+                TagCache::instance().invalidate();
+                FeedCache::instance().invalidate();
+                SnapshotCache::instance().invalidate();
+                SitemapIndex::instance().remove(postId);
+
                 wApp->setInternalPath("/", true);
             }
             catch (const std::exception&)
@@ -639,13 +758,13 @@ void PostView::bindPost(Wt::WTemplate* view, const PostType& post)
 
         static auto url(const dbo::ptr<Post>& post) { return post->url(); }
         static auto url(const dbo::ptr<PostDraft>& draft) { return draft->post->url(); }
-    };
 
-    ExpressionParser expParser;
-    expParser.registerFunction("image", [this](const auto& args)
-    {
-        return imageExpression(ExpressionParser::Expression::resolveArguments(args));
-    });
+        static auto revision(const dbo::ptr<Post>& post) { return PostDraft::Revision { post->title, post->intro, post->content }; }
+        static auto revision(const dbo::ptr<PostDraft>& draft) { return draft->revision(); }
+
+        static auto tagNames(const dbo::ptr<Post>& post) { return post->tagNames(); }
+        static auto tagNames(const dbo::ptr<PostDraft>& draft) { return draft->post ? draft->post->tagNames() : std::vector<std::string>{}; }
+    };
 
     auto author = PostResolver::author(post);
     auto created = PostResolver::created(post).toString();
@@ -654,30 +773,40 @@ void PostView::bindPost(Wt::WTemplate* view, const PostType& post)
     auto avatar = view->bindNew<Wt::WImage>("avatar", avatarLink);
     avatar->setMaximumSize(32.0, Wt::WLength("auto"));
 
-    auto intro { Markdown(post->intro.toUTF8()).renderHTML() };
-    auto content { Markdown(post->content.toUTF8()).renderHTML() };
+    auto revision = PostResolver::revision(post);
+
+    auto intro { Markdown(revision.intro.toUTF8()).renderHTML() };
+
+    // Expressions are resolved straight from cmark's buffer, WTemplate needs the result as a single string anyway.
+    const auto contentHtml = Markdown(revision.content.toUTF8()).render();
+
+    ExpressionParser expParser;
+    expParser.parse(contentHtml.view());
 
-    if (expParser.parse(content))
-        content = expParser.resolve();
+    const auto content = expParser.resolve(ExpressionContext { _session, expParser.imageAttachmentIds() });
 
-    view->bindString("title", Wt::Utils::htmlEncode(post->title));
+    view->bindString("title", Wt::Utils::htmlEncode(revision.title));
     view->bindString("intro", intro);
     view->bindString("content", content);
     view->bindNew<Wt::WAnchor>("author", Wt::WLink(Wt::LinkType::InternalPath, author->url()), author->name);
     view->bindString("created", created);
 
-    const auto& env { wApp->environment() };
+    auto tagsContainer = view->bindNew<Wt::WContainerWidget>("tags");
+    for (const auto& tagName : PostResolver::tagNames(post))
+    {
+        auto tagLink = tagsContainer->addNew<Wt::WAnchor>(Wt::WLink(Wt::LinkType::InternalPath, _session.relativePath({ "tag", tagName })), Wt::WString::fromUTF8(tagName));
+        tagLink->addStyleClass("label label-default");
+    }
 
-    // TODO: https is hardcoded here, but in fact there is no way of telling whether we're running native TLS or
-    // we are using plain HTTP behind a reverse proxy.
-    auto absoluteUrl { "https://" + env.hostName() + _session.relativePath(PostResolver::url(post))};
+    // Same configured site URL as feeds and static pages, Host header of the request doesn't matter.
+    auto absoluteUrl { _session.siteUrl() + _session.relativePath(PostResolver::url(post)) };
     auto shareButtonsView = view->bindNew<Wt::WTemplate>("shareButtons", tr("postView.shareButtons"));
 
     shareButtonsView->addFunction("tr", &Wt::WTemplate::Functions::tr);
     shareButtonsView->bindString("postUrl", absoluteUrl);
     shareButtonsView->bindString("encodedPostUrl", Wt::Utils::urlEncode(absoluteUrl));
 
-    if (!_session.siteConfig().disqusShortname().empty())
+    if (!_session.siteConfig()->disqusShortname().empty())
     {
         auto stubContainer = view->bindNew<Wt::WContainerWidget>("comments");
         stubContainer->setId("disqus_thread");
@@ -691,57 +820,6 @@ void PostView::bindPost(Wt::WTemplate* view, const PostType& post)
     }
 }
 
-std::string PostView::imageExpression(const std::vector<std::string>& args) const
-{
-    if (args.empty() || args.front().find_first_not_of("0123456789") != std::string::npos)
-        return {};
-
-    const auto& id { args.front() };
-
-    std::string caption;
-
-    if (args.size() > 1)
-        caption = std::accumulate(args.begin() + 2, args.end(), *(args.begin() + 1), [](const auto& s1, const auto& s2) { return s1 + ", " + s2; });
-
-    try
-    {
-#if 0 // Version when attachment is checked in the database.
-        dbo::Transaction t { _session };
-
-        auto query = _session.find<Attachment>().where("mimeType like 'image/%'").where("id = ?").bind(id);
-        auto attachment = query.resultValue();
-
-        if (attachment)
-        {
-            auto view { std::make_unique<Wt::WTemplate>(tr("expressions.image")) };
-            view->bindString("imageLink", _session.relativePath("attachment/" + id));
-            view->bindString("caption", caption);
-
-            std::ostringstream ss;
-            view->renderTemplate(ss);
-            return ss.str();
-        }
-#else
-        auto view { std::make_unique<Wt::WTemplate>(tr("expressions.image")) };
-        view->bindString("imageLink", _session.relativePath({ "attachment", id }));
-
-        if (!caption.empty())
-            view->bindNew<Wt::WText>("caption", caption);
-        else
-            view->bindEmpty("caption");
-
-        std::ostringstream ss;
-        view->renderTemplate(ss);
-        return ss.str();
-#endif
-    }
-    catch (const std::exception& e)
-    {
-    }
-
-    return {};
-}
-
 void PostView::setInfoMessage(const Wt::WString& message)
 {
     if (_editorControls == nullptr)
@@ -51,8 +51,6 @@ class PostView
     template<typename PostType>
     void bindPost(Wt::WTemplate* view, const PostType& post);
 
-    std::string imageExpression(const std::vector<std::string>& args) const;
-
     void setInfoMessage(const Wt::WString& message = {});
 
     Session& _session;
@@ -17,7 +17,7 @@
  */
 
 #include "PostsListView.h"
-#include "Markdown.h"
+#include "RenderPool.h"
 
 #include <Wt/WText.h>
 #include <Wt/WLink.h>
@@ -31,8 +31,11 @@ PostsListView::PostsListView(Session& session)
 {
     auto container = bindNew<Wt::WContainerWidget>("items");
 
-    dbo::Transaction t { _session };
-    auto query = _session.find<Post>();
+    // Anonymous readers are served from the read pool, see Session::readSession().
+    auto& session = _session.readSession();
+
+    dbo::Transaction t { session };
+    auto query = session.find<Post>();
     const auto isLoggedIn = _session.login().loggedIn();
 
     if (!isLoggedIn)
@@ -40,13 +43,22 @@ PostsListView::PostsListView(Session& session)
 
     query.orderBy("id desc");
 
-    for (const auto& post : query.resultList())
+    auto posts = query.resultList();
+
+    std::vector<std::string> intros;
+    for (const auto& post : posts)
+        intros.emplace_back(post->intro.toUTF8());
+
+    intros = RenderPool::instance().renderHTML(intros);
+    auto intro = intros.begin();
+
+    for (const auto& post : posts)
     {
         auto itemLink = Wt::WLink(Wt::LinkType::InternalPath, _session.relativePath(post->url()));
 
         auto item = container->addNew<Wt::WTemplate>(tr("postView.itemsList.item"));
         item->bindString("title", Wt::Utils::htmlEncode(post->title));
-        item->bindString("intro", Markdown(post->intro.toUTF8()).renderHTML());
+        item->bindString("intro", std::move(*intro++));
         item->bindWidget("link", std::make_unique<Wt::WAnchor>(itemLink, "Read more"));
         item->bindString("created", post->created.toString());
         item->bindString("author", post->author->name);
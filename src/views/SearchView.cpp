@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "SearchView.h"
+#include "SearchBackend.h"
+#include "RenderPool.h"
+
+#include "models/Editor.h"
+
+#include <Wt/WText.h>
+#include <Wt/WLink.h>
+#include <Wt/WAnchor.h>
+#include <Wt/WLineEdit.h>
+#include <Wt/WPushButton.h>
+#include <Wt/WApplication.h>
+#include <Wt/Utils.h>
+
+#include <chrono>
+#include <map>
+#include <tuple>
+
+namespace
+{
+    constexpr auto g_MaxSearchResults = 50u;
+}
+
+SearchView::SearchView(Session& session, const std::string& query)
+    : Wt::WTemplate(tr("searchView"))
+    , _session(session)
+{
+    _query = bindNew<Wt::WLineEdit>("query", Wt::WString::fromUTF8(query));
+    _query->setPlaceholderText(tr("str.searchPlaceholder"));
+    _query->enterPressed().connect(this, &SearchView::onSearch);
+
+    bindNew<Wt::WPushButton>("searchButton", tr("str.search"))->clicked().connect(this, &SearchView::onSearch);
+
+    _items = bindNew<Wt::WContainerWidget>("items");
+
+    showResults(query);
+}
+
+void SearchView::onSearch()
+{
+    auto query = _query->text().trim().toUTF8();
+
+    wApp->setInternalPath(query.empty() ? _session.relativePath("search") : _session.relativePath({ "search", Wt::Utils::urlEncode(query) }));
+    showResults(query);
+}
+
+void SearchView::showResults(const std::string& query)
+{
+    _items->clear();
+
+    if (query.empty())
+    {
+        bindEmpty("summary");
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto isLoggedIn = _session.login().loggedIn();
+
+    // Anonymous readers are served from the read pool, see Session::readSession().
+    auto& session = _session.readSession();
+    dbo::Transaction t { session };
+    const auto results = SearchBackend::instance().search(session, query, g_MaxSearchResults, isLoggedIn);
+
+    std::map<long long, dbo::ptr<Post>> posts;
+
+    if (!results.empty())
+    {
+        // Fetch all matching posts at once, order is restored from search results below. Authors are loaded by the
+        // same query, so listing them doesn't cost a query per result.
+        std::string placeholders;
+        for (std::size_t i = 0u; i < results.size(); ++i)
+            placeholders += i == 0u ? "?" : ", ?";
+
+        auto postsQuery = session.query<std::tuple<dbo::ptr<Post>, dbo::ptr<Editor>>>("select p, e from post p join editor e on e.id = p.editor_id")
+            .where("p.id in (" + placeholders + ")");
+
+        for (const auto& result : results)
+            postsQuery.bind(result.id);
+
+        if (!isLoggedIn)
+            postsQuery.where("p.visibility = ?").bind(Post::Visibility::Published);
+
+        for (auto& row : postsQuery.resultList())
+        {
+            auto& post = std::get<0>(row);
+            posts.emplace(post.id(), std::move(post));
+        }
+    }
+
+    // Results are reduced to visible posts first, so their intros can be rendered in one batch.
+    std::vector<dbo::ptr<Post>> found;
+    std::vector<std::string> intros;
+
+    for (const auto& result : results)
+    {
+        auto it = posts.find(result.id);
+        if (it == posts.end())
+            continue;
+
+        found.emplace_back(it->second);
+        intros.emplace_back(it->second->intro.toUTF8());
+    }
+
+    intros = RenderPool::instance().renderHTML(intros);
+    auto intro = intros.begin();
+    auto count = 0u;
+
+    for (const auto& post : found)
+    {
+        auto itemLink = Wt::WLink(Wt::LinkType::InternalPath, _session.relativePath(post->url()));
+
+        auto item = _items->addNew<Wt::WTemplate>(tr("postView.itemsList.item"));
+        item->bindString("title", Wt::Utils::htmlEncode(post->title));
+        item->bindString("intro", std::move(*intro++));
+        item->bindWidget("link", std::make_unique<Wt::WAnchor>(itemLink, "Read more"));
+        item->bindString("created", post->created.toString());
+        item->bindString("author", post->author->name);
+        item->bindEmpty("visibility");
+
+        ++count;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    bindString("summary", tr("str.searchSummary").arg(count).arg(static_cast<int>(elapsed.count())));
+
+    doJavaScript("$('#" + id() + "').find('code[class*=language-], pre[class*=language-]').each(function() { hljs.highlightBlock(this); $(this).removeClass('hljs'); });");
+}
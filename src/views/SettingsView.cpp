@@ -18,6 +18,8 @@
 
 #include "SettingsView.h"
 #include "models/Editor.h"
+#include "FeedCache.h"
+#include "SnapshotCache.h"
 #include "settings/SettingsTabEditor.h"
 
 #include <Wt/WApplication.h>
@@ -81,7 +83,7 @@ namespace
         explicit SiteConfigFormView(Session& session)
             : _session(session)
         {
-            _model = std::make_shared<SiteConfigFormModel>(session.siteConfig());
+            _model = std::make_shared<SiteConfigFormModel>(*session.siteConfig());
 
             setTemplateText(tr("settings.siteConfigForm"));
             addFunction("id", &Wt::WTemplate::Functions::id);
@@ -114,15 +116,22 @@ namespace
                     throw std::runtime_error("Form is not valid");
 
                 dbo::Transaction t { _session };
-                auto& siteConfig { _session.siteConfig() };
 
-                siteConfig.siteName(_model->valueText(SiteConfigFormModel::SiteNameField).toUTF8());
-                siteConfig.about(_model->valueText(SiteConfigFormModel::AboutField).toUTF8());
-                siteConfig.footer(_model->valueText(SiteConfigFormModel::FooterField).toUTF8());
-                siteConfig.disqusShortname(_model->valueText(SiteConfigFormModel::DisqusShortnameField).toUTF8());
+                auto siteConfig = SiteConfig::store(_session,
+                    _model->valueText(SiteConfigFormModel::SiteNameField).toUTF8(),
+                    _model->valueText(SiteConfigFormModel::AboutField).toUTF8(),
+                    _model->valueText(SiteConfigFormModel::FooterField).toUTF8(),
+                    _model->valueText(SiteConfigFormModel::DisqusShortnameField).toUTF8());
 
                 t.commit();
 
+                // New configuration becomes visible to all sessions at once.
+                SiteConfig::publish(std::move(siteConfig));
+
+                // Site name and footer are a part of feeds and static pages.
+                FeedCache::instance().invalidate();
+                SnapshotCache::instance().invalidate();
+
                 setStatus(tr("str.siteConfigurationSuccessfullySaved"));
             }
             catch (const std::exception& e)
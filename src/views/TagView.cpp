@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "TagView.h"
+#include "TagCache.h"
+#include "ApplicationExceptions.h"
+#include "RenderPool.h"
+
+#include "models/Tag.h"
+
+#include <Wt/WText.h>
+#include <Wt/WLink.h>
+#include <Wt/WAnchor.h>
+#include <Wt/WApplication.h>
+#include <Wt/Utils.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    constexpr auto g_PostsPerPage = 10u;
+}
+
+TagView::TagView(Session& session, const std::string& tag, long long before)
+    : Wt::WTemplate(tr("tagView"))
+    , _session(session)
+{
+    const auto isLoggedIn = _session.login().loggedIn();
+
+    // Anonymous readers are served from the read pool, see Session::readSession().
+    auto& session = _session.readSession();
+    dbo::Transaction t { session };
+    std::vector<dbo::ptr<Post>> posts;
+
+    if (isLoggedIn)
+    {
+        // Editors see hidden posts as well, those are not cached. Read the page with one query over join table.
+        auto query = session.query<dbo::ptr<Post>>("select p from post p join post_tag pt on pt.post_id = p.id join tag t on t.id = pt.tag_id")
+            .where("t.name = ?").bind(tag);
+
+        if (before > 0)
+            query.where("p.id < ?").bind(before);
+
+        // One more post is requested to find out whether there is a next page.
+        for (auto& post : query.orderBy("p.id desc").limit(g_PostsPerPage + 1).resultList())
+            posts.emplace_back(std::move(post));
+    }
+    else
+    {
+        auto postIds = TagCache::instance().publishedPosts(session, tag);
+
+        // Ids are sorted in descending order, find the first one older than 'before'.
+        auto begin = before > 0 ? std::upper_bound(postIds->begin(), postIds->end(), before, std::greater<>()) : postIds->begin();
+        auto end = begin + std::min<std::ptrdiff_t>(std::distance(begin, postIds->end()), g_PostsPerPage + 1);
+
+        if (begin != end)
+        {
+            std::string placeholders;
+            for (auto it = begin; it != end; ++it)
+                placeholders += it == begin ? "?" : ", ?";
+
+            auto query = session.find<Post>().where("id in (" + placeholders + ")");
+
+            for (auto it = begin; it != end; ++it)
+                query.bind(*it);
+
+            query.where("visibility = ?").bind(Post::Visibility::Published);
+
+            for (auto& post : query.orderBy("id desc").resultList())
+                posts.emplace_back(std::move(post));
+        }
+    }
+
+    if (posts.empty() && before == 0)
+        throw PageNotFoundException();
+
+    const auto hasMore = posts.size() > g_PostsPerPage;
+    if (hasMore)
+        posts.resize(g_PostsPerPage);
+
+    bindString("tag", Wt::Utils::htmlEncode(Wt::WString::fromUTF8(tag)));
+
+    std::vector<std::string> intros;
+    for (const auto& post : posts)
+        intros.emplace_back(post->intro.toUTF8());
+
+    intros = RenderPool::instance().renderHTML(intros);
+    auto intro = intros.begin();
+
+    auto container = bindNew<Wt::WContainerWidget>("items");
+
+    for (const auto& post : posts)
+    {
+        auto itemLink = Wt::WLink(Wt::LinkType::InternalPath, _session.relativePath(post->url()));
+
+        auto item = container->addNew<Wt::WTemplate>(tr("postView.itemsList.item"));
+        item->bindString("title", Wt::Utils::htmlEncode(post->title));
+        item->bindString("intro", std::move(*intro++));
+        item->bindWidget("link", std::make_unique<Wt::WAnchor>(itemLink, "Read more"));
+        item->bindString("created", post->created.toString());
+        item->bindString("author", post->author->name);
+
+        if (isLoggedIn && post->visibility == Post::Visibility::Hidden)
+            item->bindNew<Wt::WText>("visibility", "Hidden")->addStyleClass("label label-warning");
+        else
+            item->bindEmpty("visibility");
+    }
+
+    if (hasMore)
+    {
+        auto olderLink = Wt::WLink(Wt::LinkType::InternalPath, _session.relativePath({ "tag", tag, std::to_string(posts.back().id()) }));
+        bindNew<Wt::WAnchor>("olderPosts", olderLink, tr("str.olderPosts"));
+    }
+    else
+    {
+        bindEmpty("olderPosts");
+    }
+
+    doJavaScript("$('#" + id() + "').find('code[class*=language-], pre[class*=language-]').each(function() { hljs.highlightBlock(this); $(this).removeClass('hljs'); });");
+}
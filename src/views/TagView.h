@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2020 adrian_007, adrian-007 on o2 point pl
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <Wt/WTemplate.h>
+
+#include "models/Session.h"
+#include "models/Post.h"
+
+#include "CompositeWrapper.h"
+
+class TagView
+    : public CompositeWrapper<TagView>
+    , public Wt::WTemplate
+{
+    friend class CompositeWrapper<TagView>;
+
+    /**
+     * Shows a page of posts with given tag, older than post with id given by 'before' (keyset pagination).
+     * First page is shown when 'before' is 0.
+     */
+    TagView(Session& session, const std::string& tag, long long before);
+
+    Session& _session;
+};